@@ -1149,3 +1149,1013 @@ file(REMOVE "buffer_squeezed.bin" "buffer_restored.txt")
 
 # Clean up global non-batch input artifact
 file(REMOVE "buffer_copy.txt")
+
+# =====================================================================
+# STAGE 24: Recompression with a different history buffer size
+# =====================================================================
+if(GKRECOMPRESS)
+    cmake_path(NATIVE_PATH GKRECOMPRESS GKRECOMPRESS)
+    message(STATUS "Starting Recompression Verification...")
+
+    # 1. Compress using the default history log-2 value
+    execute_process(
+        COMMAND ${GKCOMP} -history 9 "buffer_original.txt" "buffer_squeezed.bin"
+        RESULT_VARIABLE cmd_res
+    )
+    if(NOT cmd_res EQUAL 0)
+        message(FATAL_ERROR "Compression failed with code ${cmd_res}")
+    endif()
+
+    # 2. Recompress using a larger history log-2 value
+    execute_process(
+        COMMAND ${GKRECOMPRESS} -from 9 -to 12 "buffer_squeezed.bin" "buffer_resqueezed.bin"
+        RESULT_VARIABLE cmd_res
+    )
+    if(NOT cmd_res EQUAL 0)
+        message(FATAL_ERROR "Recompression failed with code ${cmd_res}")
+    endif()
+
+    # 3. Decompress using the larger history log-2 value
+    execute_process(
+        COMMAND ${GKDECOMP} -history 12 "buffer_resqueezed.bin" "buffer_restored.txt"
+        RESULT_VARIABLE cmd_res
+    )
+    if(NOT cmd_res EQUAL 0)
+        message(FATAL_ERROR "Decompression of recompressed file failed with code ${cmd_res}")
+    endif()
+
+    execute_process(
+        COMMAND ${CMAKE_COMMAND} -E compare_files "buffer_original.txt" "buffer_restored.txt"
+        RESULT_VARIABLE diff_res
+    )
+    if(diff_res)
+        message(FATAL_ERROR "FAILURE: File corruption detected after recompression!")
+    else()
+        message(STATUS "SUCCESS: Lossless match verified after recompression")
+    endif()
+
+    # 4. Recompress in-place back to the original history log-2 value
+    execute_process(
+        COMMAND ${GKRECOMPRESS} -batch -from 12 -to 9 "buffer_resqueezed.bin"
+        RESULT_VARIABLE cmd_res
+    )
+    if(NOT cmd_res EQUAL 0)
+        message(FATAL_ERROR "Batch recompression failed with code ${cmd_res}")
+    endif()
+
+    execute_process(
+        COMMAND ${GKDECOMP} "buffer_resqueezed.bin" "buffer_restored.txt"
+        RESULT_VARIABLE cmd_res
+    )
+    if(NOT cmd_res EQUAL 0)
+        message(FATAL_ERROR "Decompression of batch recompressed file failed with code ${cmd_res}")
+    endif()
+
+    execute_process(
+        COMMAND ${CMAKE_COMMAND} -E compare_files "buffer_original.txt" "buffer_restored.txt"
+        RESULT_VARIABLE diff_res
+    )
+    if(diff_res)
+        message(FATAL_ERROR "FAILURE: File corruption detected after batch recompression!")
+    else()
+        message(STATUS "SUCCESS: Lossless match verified after batch recompression")
+    endif()
+
+    # 5. Recompress with the wrong input history log-2 value
+    execute_process(
+        COMMAND ${GKRECOMPRESS} -from 10 -to 9 "buffer_squeezed.bin" "buffer_resqueezed.bin"
+        RESULT_VARIABLE cmd_res
+        ERROR_VARIABLE recomp_stderr
+    )
+    if(cmd_res EQUAL 0)
+        message(FATAL_ERROR "Expected recompression failure did not happen")
+    endif()
+
+    # 6. The history switch is not used by the recompressor
+    execute_process(
+        COMMAND ${GKRECOMPRESS} -history 9 "buffer_squeezed.bin" "buffer_resqueezed.bin"
+        RESULT_VARIABLE cmd_res
+        ERROR_VARIABLE recomp_stderr
+    )
+    if(cmd_res EQUAL 0)
+        message(FATAL_ERROR "Recompression with -history unexpectedly succeeded")
+    endif()
+
+    # Clean up files from this stage
+    file(REMOVE "buffer_squeezed.bin" "buffer_resqueezed.bin" "buffer_restored.txt")
+endif()
+
+# =====================================================================
+# STAGE 25: Watch mode (which needs inotify and POSIX threads)
+# =====================================================================
+if(CMAKE_HOST_SYSTEM_NAME STREQUAL "Linux" AND GKEY_THREADS)
+    message(STATUS "Starting Watch Mode Verification...")
+
+    file(REMOVE_RECURSE "watch_src" "watch_dst")
+    file(MAKE_DIRECTORY "watch_src" "watch_dst")
+    file(COPY_FILE "buffer_original.txt" "watch_src/old.txt")
+
+    # 1. Watch mode requires an output directory
+    execute_process(
+        COMMAND ${GKCOMP} -watch "watch_src"
+        RESULT_VARIABLE cmd_res
+        ERROR_VARIABLE comp_stderr
+    )
+    if(cmd_res EQUAL 0 OR NOT comp_stderr MATCHES "Must specify an output directory in watch mode")
+        message(FATAL_ERROR "Failure: unexpected watch mode result. Received: '${comp_stderr}'")
+    endif()
+
+    # 2. Compress a file that already exists and one added while watching.
+    # Each output file appears all at once when renamed, so wait for it
+    # (for up to 30 seconds) before going on.
+    execute_process(
+        COMMAND sh -c [=[
+            wait_for() {
+                i=0
+                while [ ! -f "$1" ]; do
+                    [ $i -ge 300 ] && return 1
+                    sleep 0.1
+                    i=$((i + 1))
+                done
+            }
+            "$1" -watch watch_src -outfile watch_dst & pid=$!
+            wait_for watch_dst/old.txt &&
+                cp buffer_original.txt watch_src/new.txt &&
+                wait_for watch_dst/new.txt
+            found=$?
+            kill -TERM $pid
+            wait $pid && exit $found
+        ]=] sh ${GKCOMP}
+        RESULT_VARIABLE cmd_res
+    )
+    if(NOT cmd_res EQUAL 0)
+        message(FATAL_ERROR "Failure: watched files not compressed, or watch mode not stopped cleanly (code ${cmd_res})")
+    endif()
+
+    # 3. No temporary files are left behind
+    file(GLOB WATCH_LEFTOVERS LIST_DIRECTORIES true "watch_dst/.*")
+    if(WATCH_LEFTOVERS)
+        message(FATAL_ERROR "Failure: temporary files left in output directory: ${WATCH_LEFTOVERS}")
+    endif()
+
+    foreach(WATCH_FILE "old.txt" "new.txt")
+        execute_process(
+            COMMAND ${GKDECOMP} "watch_dst/${WATCH_FILE}" "buffer_restored.txt"
+            RESULT_VARIABLE cmd_res
+        )
+        if(NOT cmd_res EQUAL 0)
+            message(FATAL_ERROR "Decompression of watched file ${WATCH_FILE} failed with code ${cmd_res}")
+        endif()
+
+        execute_process(
+            COMMAND ${CMAKE_COMMAND} -E compare_files "buffer_original.txt" "buffer_restored.txt"
+            RESULT_VARIABLE diff_res
+        )
+        if(diff_res)
+            message(FATAL_ERROR "FAILURE: File corruption detected in watched file ${WATCH_FILE}!")
+        else()
+            message(STATUS "SUCCESS: Lossless match verified for watched file ${WATCH_FILE}")
+        endif()
+    endforeach()
+
+    # Clean up files from this stage
+    file(REMOVE_RECURSE "watch_src" "watch_dst")
+    file(REMOVE "buffer_restored.txt")
+endif()
+
+# =====================================================================
+# STAGE 26: Long runs of zeros in decompressed output
+# =====================================================================
+if(CMAKE_HOST_UNIX)
+    message(STATUS "Starting Zero Run Verification...")
+
+    # Runs of zeros in the middle and at the end of the file, either side
+    # of the minimum size for a hole
+    execute_process(
+        COMMAND sh -c "{ echo start; head -c 100000 /dev/zero; echo middle; head -c 4095 /dev/zero; echo end; head -c 200000 /dev/zero; } > buffer_zeros.bin"
+        RESULT_VARIABLE cmd_res
+    )
+    if(NOT cmd_res EQUAL 0)
+        message(FATAL_ERROR "Failed to create file of zeros with code ${cmd_res}")
+    endif()
+
+    execute_process(
+        COMMAND ${GKCOMP} "buffer_zeros.bin" "buffer_squeezed.bin"
+        RESULT_VARIABLE cmd_res
+    )
+    if(NOT cmd_res EQUAL 0)
+        message(FATAL_ERROR "Compression of zeros failed with code ${cmd_res}")
+    endif()
+
+    # 1. Decompress to a named file (which may contain holes)
+    execute_process(
+        COMMAND ${GKDECOMP} "buffer_squeezed.bin" "buffer_restored.bin"
+        RESULT_VARIABLE cmd_res
+    )
+    if(NOT cmd_res EQUAL 0)
+        message(FATAL_ERROR "Decompression of zeros failed with code ${cmd_res}")
+    endif()
+
+    execute_process(
+        COMMAND ${CMAKE_COMMAND} -E compare_files "buffer_zeros.bin" "buffer_restored.bin"
+        RESULT_VARIABLE diff_res
+    )
+    if(diff_res)
+        message(FATAL_ERROR "FAILURE: File corruption detected in decompressed zeros!")
+    else()
+        message(STATUS "SUCCESS: Lossless match verified for decompressed zeros")
+    endif()
+
+    # 2. The verbose output reports the holes that were left
+    execute_process(
+        COMMAND ${GKDECOMP} -verbose "buffer_squeezed.bin" "buffer_restored.bin"
+        OUTPUT_VARIABLE cmd_out
+        RESULT_VARIABLE cmd_res
+    )
+    if(NOT cmd_res EQUAL 0)
+        message(FATAL_ERROR "Verbose decompression of zeros failed with code ${cmd_res}")
+    endif()
+    if(NOT cmd_out MATCHES "Left holes instead of writing [0-9]+ bytes of zeros")
+        message(FATAL_ERROR "FAILURE: No holes reported in decompressed zeros:\n${cmd_out}")
+    endif()
+
+    # 3. Decompress in place (via a temporary file) in batch mode
+    file(COPY_FILE "buffer_squeezed.bin" "buffer_batch.bin")
+    execute_process(
+        COMMAND ${GKDECOMP} -batch -verbose "buffer_batch.bin"
+        OUTPUT_VARIABLE cmd_out
+        RESULT_VARIABLE cmd_res
+    )
+    if(NOT cmd_res EQUAL 0)
+        message(FATAL_ERROR "Batch decompression of zeros failed with code ${cmd_res}")
+    endif()
+    if(NOT cmd_out MATCHES "Left holes instead of copying [0-9]+ bytes of zeros")
+        message(FATAL_ERROR "FAILURE: No holes reported in zeros decompressed in place:\n${cmd_out}")
+    endif()
+
+    execute_process(
+        COMMAND ${CMAKE_COMMAND} -E compare_files "buffer_zeros.bin" "buffer_batch.bin"
+        RESULT_VARIABLE diff_res
+    )
+    if(diff_res)
+        message(FATAL_ERROR "FAILURE: File corruption detected in zeros decompressed in place!")
+    else()
+        message(STATUS "SUCCESS: Lossless match verified for zeros decompressed in place")
+    endif()
+
+    # 4. Decompress to a pipe (which cannot contain holes)
+    execute_process(
+        COMMAND ${GKDECOMP} "buffer_squeezed.bin"
+        COMMAND cat
+        OUTPUT_FILE "buffer_restored.bin"
+        RESULT_VARIABLE cmd_res
+    )
+    if(NOT cmd_res EQUAL 0)
+        message(FATAL_ERROR "Decompression of zeros to a pipe failed with code ${cmd_res}")
+    endif()
+
+    execute_process(
+        COMMAND ${CMAKE_COMMAND} -E compare_files "buffer_zeros.bin" "buffer_restored.bin"
+        RESULT_VARIABLE diff_res
+    )
+    if(diff_res)
+        message(FATAL_ERROR "FAILURE: File corruption detected in zeros decompressed to a pipe!")
+    else()
+        message(STATUS "SUCCESS: Lossless match verified for zeros decompressed to a pipe")
+    endif()
+
+    # Clean up files from this stage
+    file(REMOVE "buffer_zeros.bin" "buffer_squeezed.bin" "buffer_restored.bin"
+                "buffer_batch.bin")
+endif()
+
+# =====================================================================
+# STAGE 27: Concatenation of several compressed files
+# =====================================================================
+if(GKCAT)
+    cmake_path(NATIVE_PATH GKCAT GKCAT)
+    message(STATUS "Starting Concatenation Verification...")
+
+    file(WRITE "buffer_short.txt" "${TEXT_BLOCK}\n")
+    file(READ "buffer_original.txt" ORIGINAL_TEXT)
+    file(WRITE "buffer_expected.txt" "${ORIGINAL_TEXT}${TEXT_BLOCK}\n${ORIGINAL_TEXT}")
+
+    foreach(CAT_FILE "buffer_original" "buffer_short")
+        execute_process(
+            COMMAND ${GKCOMP} -history 10 "${CAT_FILE}.txt" "${CAT_FILE}.bin"
+            RESULT_VARIABLE cmd_res
+        )
+        if(NOT cmd_res EQUAL 0)
+            message(FATAL_ERROR "Compression of ${CAT_FILE} failed with code ${cmd_res}")
+        endif()
+    endforeach()
+
+    # 1. Concatenate files in the order specified
+    execute_process(
+        COMMAND ${GKCAT} -history 10 "buffer_original.bin" "buffer_short.bin" "buffer_original.bin"
+        OUTPUT_FILE "buffer_restored.txt"
+        RESULT_VARIABLE cmd_res
+    )
+    if(NOT cmd_res EQUAL 0)
+        message(FATAL_ERROR "Concatenation failed with code ${cmd_res}")
+    endif()
+
+    execute_process(
+        COMMAND ${CMAKE_COMMAND} -E compare_files "buffer_expected.txt" "buffer_restored.txt"
+        RESULT_VARIABLE diff_res
+    )
+    if(diff_res)
+        message(FATAL_ERROR "FAILURE: File corruption detected in concatenated output!")
+    else()
+        message(STATUS "SUCCESS: Lossless match verified for concatenated output")
+    endif()
+
+    # 2. Separator and file name prefix
+    execute_process(
+        COMMAND ${GKCAT} -history 10 -prefix -separator "--" "buffer_short.bin" "buffer_short.bin"
+        OUTPUT_VARIABLE cat_stdout
+        RESULT_VARIABLE cmd_res
+    )
+    if(NOT cmd_res EQUAL 0)
+        message(FATAL_ERROR "Concatenation with separator failed with code ${cmd_res}")
+    endif()
+
+    if(NOT cat_stdout STREQUAL "buffer_short.bin:${TEXT_BLOCK}\n--\nbuffer_short.bin:${TEXT_BLOCK}\n")
+        message(FATAL_ERROR "Failure: unexpected concatenated output. Received: '${cat_stdout}'")
+    else()
+        message(STATUS "Success: separator and prefix verified.")
+    endif()
+
+    # 3. A missing file is reported but the others are still output
+    execute_process(
+        COMMAND ${GKCAT} -history 10 "buffer_short.bin" "buffer_missing.bin" "buffer_short.bin"
+        OUTPUT_VARIABLE cat_stdout
+        ERROR_VARIABLE cat_stderr
+        RESULT_VARIABLE cmd_res
+    )
+    if(cmd_res EQUAL 0)
+        message(FATAL_ERROR "Concatenation of a missing file unexpectedly succeeded")
+    endif()
+
+    if(NOT cat_stdout STREQUAL "${TEXT_BLOCK}\n${TEXT_BLOCK}\n" OR
+       NOT cat_stderr MATCHES "Failed to decompress 'buffer_missing.bin'")
+        message(FATAL_ERROR "Failure: unexpected output for missing file. Received: '${cat_stdout}' '${cat_stderr}'")
+    else()
+        message(STATUS "Success: missing file reported.")
+    endif()
+
+    # 4. A write error stops the files being read ahead without reporting
+    #    that they failed to decompress
+    if(EXISTS "/dev/full")
+        execute_process(
+            COMMAND ${GKCAT} -history 10 "buffer_original.bin" "buffer_original.bin" "buffer_original.bin" "buffer_original.bin"
+            OUTPUT_FILE "/dev/full"
+            ERROR_VARIABLE cat_stderr
+            RESULT_VARIABLE cmd_res
+        )
+        if(cmd_res EQUAL 0)
+            message(FATAL_ERROR "Concatenation to a full device unexpectedly succeeded")
+        endif()
+
+        if(NOT cat_stderr MATCHES "Failed to write" OR
+           cat_stderr MATCHES "Failed to decompress")
+            message(FATAL_ERROR "Failure: unexpected errors for write failure. Received: '${cat_stderr}'")
+        else()
+            message(STATUS "Success: write error reported.")
+        endif()
+    endif()
+
+    # 5. A file of the wrong size is reported after the output of the files
+    #    before it, even though it was decompressed while they were written
+    if(CMAKE_HOST_UNIX)
+        execute_process(
+            COMMAND sh -c "{ printf '\\377\\0\\0\\0'; tail -c +5 buffer_short.bin; } > buffer_bad.bin && \"$1\" -history 10 buffer_original.bin buffer_bad.bin buffer_short.bin 2>&1" sh "${GKCAT}"
+            OUTPUT_VARIABLE cat_stdout
+            RESULT_VARIABLE cmd_res
+        )
+        if(cmd_res EQUAL 0)
+            message(FATAL_ERROR "Concatenation of a file of the wrong size unexpectedly succeeded")
+        endif()
+
+        string(LENGTH "${TEXT_BLOCK}\n" SHORT_SIZE)
+        if(NOT cat_stdout STREQUAL "${ORIGINAL_TEXT}${TEXT_BLOCK}\nDecompressed ${SHORT_SIZE} bytes but expected 255\nFailed to decompress 'buffer_bad.bin'\n${TEXT_BLOCK}\n")
+            message(FATAL_ERROR "Failure: size error not reported in order. Received: '${cat_stdout}'")
+        else()
+            message(STATUS "Success: size error reported in order.")
+        endif()
+    endif()
+
+    # Clean up files from this stage
+    file(REMOVE "buffer_short.txt" "buffer_short.bin" "buffer_original.bin"
+         "buffer_bad.bin" "buffer_expected.txt" "buffer_restored.txt")
+endif()
+
+# =====================================================================
+# STAGE 28: Skipping incompressible files in batch mode
+# =====================================================================
+message(STATUS "Starting Incompressible File Verification...")
+
+# Random text has too few repeated strings to be worth copying, so each
+# byte would cost 9 bits instead of 8. (Compressed data is not a reliable
+# example: the output for repetitive input may itself be repetitive.)
+string(RANDOM LENGTH 40000 RANDOM_SEED 28 RANDOM_TEXT)
+file(WRITE "buffer_packed.bin" "${RANDOM_TEXT}")
+file(COPY_FILE "buffer_packed.bin" "buffer_skipped.bin")
+file(COPY_FILE "buffer_original.txt" "buffer_forced.txt")
+
+# 1. The compressed file is left untouched and reported
+execute_process(
+    COMMAND ${GKCOMP} -batch -skip-incompressible -time "buffer_skipped.bin"
+    OUTPUT_VARIABLE skip_stdout
+    RESULT_VARIABLE cmd_res
+)
+if(NOT cmd_res EQUAL 0)
+    message(FATAL_ERROR "Batch compression with skipping failed with code ${cmd_res}")
+endif()
+
+execute_process(
+    COMMAND ${CMAKE_COMMAND} -E compare_files "buffer_packed.bin" "buffer_skipped.bin"
+    RESULT_VARIABLE diff_res
+)
+if(diff_res)
+    message(FATAL_ERROR "FAILURE: Incompressible file was modified!")
+endif()
+
+if(NOT skip_stdout MATCHES "Time taken to sample: [0-9]+\\.[0-9]+ seconds" OR
+   NOT skip_stdout MATCHES "Skipped 'buffer_skipped.bin'" OR
+   NOT skip_stdout MATCHES "Skipped 1 of 1 files")
+    message(FATAL_ERROR "Failure: skipped file not reported. Received: '${skip_stdout}'")
+else()
+    message(STATUS "Success: incompressible file skipped.")
+endif()
+
+# 2. A generous threshold lets both files be compressed
+execute_process(
+    COMMAND ${GKCOMP} -batch -skip-incompressible=1000 "buffer_skipped.bin" "buffer_forced.txt"
+    RESULT_VARIABLE cmd_res
+)
+if(NOT cmd_res EQUAL 0)
+    message(FATAL_ERROR "Batch compression with a high threshold failed with code ${cmd_res}")
+endif()
+
+foreach(FORCED_PAIR "buffer_packed.bin;buffer_skipped.bin" "buffer_original.txt;buffer_forced.txt")
+    execute_process(
+        COMMAND ${CMAKE_COMMAND} -E compare_files ${FORCED_PAIR}
+        RESULT_VARIABLE diff_res
+    )
+    if(NOT diff_res)
+        message(FATAL_ERROR "FAILURE: File was not compressed despite a high threshold!")
+    endif()
+endforeach()
+
+execute_process(
+    COMMAND ${GKDECOMP} "buffer_forced.txt" "buffer_restored.txt"
+    RESULT_VARIABLE cmd_res
+)
+execute_process(
+    COMMAND ${CMAKE_COMMAND} -E compare_files "buffer_original.txt" "buffer_restored.txt"
+    RESULT_VARIABLE diff_res
+)
+if(NOT cmd_res EQUAL 0 OR diff_res)
+    message(FATAL_ERROR "FAILURE: File corruption detected after batch compression!")
+else()
+    message(STATUS "Success: files compressed with a high threshold.")
+endif()
+
+# 3. A small file is compressed in full to decide, giving the same output as
+#    compressing it normally, and the count is reported without '-time'
+string(SUBSTRING "${LARGE_TEXT}" 0 20000 SMALL_TEXT)
+string(SUBSTRING "${RANDOM_TEXT}" 0 20000 SMALL_RANDOM_TEXT)
+file(WRITE "buffer_small.txt" "${SMALL_TEXT}")
+file(WRITE "buffer_small_random.bin" "${SMALL_RANDOM_TEXT}")
+file(COPY_FILE "buffer_small_random.bin" "buffer_small_skipped.bin")
+file(COPY_FILE "buffer_small.txt" "buffer_small_batch.bin")
+
+execute_process(
+    COMMAND ${GKCOMP} "buffer_small.txt" "buffer_small_ref.bin"
+    RESULT_VARIABLE cmd_res
+)
+if(NOT cmd_res EQUAL 0)
+    message(FATAL_ERROR "Compression of small file failed with code ${cmd_res}")
+endif()
+
+execute_process(
+    COMMAND ${GKCOMP} -batch -skip-incompressible "buffer_small_skipped.bin" "buffer_small_batch.bin"
+    OUTPUT_VARIABLE skip_stdout
+    RESULT_VARIABLE cmd_res
+)
+if(NOT cmd_res EQUAL 0)
+    message(FATAL_ERROR "Batch compression of small files failed with code ${cmd_res}")
+endif()
+
+foreach(SMALL_PAIR "buffer_small_random.bin;buffer_small_skipped.bin" "buffer_small_ref.bin;buffer_small_batch.bin")
+    execute_process(
+        COMMAND ${CMAKE_COMMAND} -E compare_files ${SMALL_PAIR}
+        RESULT_VARIABLE diff_res
+    )
+    if(diff_res)
+        message(FATAL_ERROR "FAILURE: Unexpected output for small file (${SMALL_PAIR})!")
+    endif()
+endforeach()
+
+if(NOT skip_stdout MATCHES "Skipped 1 of 2 files" OR
+   skip_stdout MATCHES "Skipped 'buffer_small_skipped.bin'")
+    message(FATAL_ERROR "Failure: skip count not reported alone. Received: '${skip_stdout}'")
+else()
+    message(STATUS "Success: small files decided by compressing them in full.")
+endif()
+
+# 4. Skipping is only allowed in batch mode, with a valid ratio
+foreach(BAD_ARGS "-skip-incompressible;buffer_forced.txt" "-batch;-skip-incompressible=0;buffer_forced.txt" "-batch;-skip-incompressible=x;buffer_forced.txt")
+    execute_process(
+        COMMAND ${GKCOMP} ${BAD_ARGS}
+        OUTPUT_QUIET
+        ERROR_QUIET
+        RESULT_VARIABLE cmd_res
+    )
+    if(cmd_res EQUAL 0)
+        message(FATAL_ERROR "Failure: '${BAD_ARGS}' was unexpectedly accepted")
+    endif()
+endforeach()
+message(STATUS "Success: invalid use of -skip-incompressible rejected.")
+
+# Clean up files from this stage
+file(REMOVE "buffer_packed.bin" "buffer_skipped.bin" "buffer_forced.txt"
+     "buffer_restored.txt" "buffer_small.txt" "buffer_small_random.bin"
+     "buffer_small_skipped.bin" "buffer_small_batch.bin"
+     "buffer_small_ref.bin")
+
+# =====================================================================
+# STAGE 29: Choice of CPU code path
+# =====================================================================
+message(STATUS "Starting CPU Code Path Verification...")
+
+# 1. The scalar path is always available
+execute_process(
+    COMMAND ${GKCOMP} -cpu scalar -level 9 -verbose "buffer_original.txt" "buffer_squeezed.bin"
+    OUTPUT_VARIABLE comp_stdout
+    RESULT_VARIABLE cmd_res
+)
+if(NOT cmd_res EQUAL 0)
+    message(FATAL_ERROR "Compression with scalar code path failed with code ${cmd_res}")
+endif()
+
+if(NOT comp_stdout MATCHES "CPU supports code paths: scalar.*\\(using up to scalar\\)")
+    message(FATAL_ERROR "Failure: code paths not reported. Received: '${comp_stdout}'")
+endif()
+
+execute_process(
+    COMMAND ${GKDECOMP} "buffer_squeezed.bin" "buffer_restored.txt"
+    RESULT_VARIABLE cmd_res
+)
+execute_process(
+    COMMAND ${CMAKE_COMMAND} -E compare_files "buffer_original.txt" "buffer_restored.txt"
+    RESULT_VARIABLE diff_res
+)
+if(NOT cmd_res EQUAL 0 OR diff_res)
+    message(FATAL_ERROR "FAILURE: File corruption detected with scalar code path!")
+else()
+    message(STATUS "Success: scalar code path verified.")
+endif()
+
+# 2. Every code path that this CPU supports produces the same output as the
+#    scalar one when compressing with an exhaustive match search. The paths
+#    are taken from the report in step 1, so unsupported paths are skipped.
+string(REGEX MATCH "CPU supports code paths:([^(\n]*)\\(" cpu_line "${comp_stdout}")
+separate_arguments(CPU_PATHS UNIX_COMMAND "${CMAKE_MATCH_1}")
+list(REMOVE_ITEM CPU_PATHS "scalar")
+
+execute_process(
+    COMMAND ${GKCOMP} -cpu scalar -level 9 "buffer_original.txt" "buffer_scalar.bin"
+    RESULT_VARIABLE cmd_res
+)
+if(NOT cmd_res EQUAL 0)
+    message(FATAL_ERROR "Compression at level 9 with scalar code path failed with code ${cmd_res}")
+endif()
+
+if(NOT CPU_PATHS)
+    message(STATUS "Skipping: this CPU supports no code path but scalar.")
+endif()
+
+foreach(CPU_PATH ${CPU_PATHS})
+    execute_process(
+        COMMAND ${GKCOMP} -cpu ${CPU_PATH} -level 9 "buffer_original.txt" "buffer_squeezed.bin"
+        RESULT_VARIABLE cmd_res
+    )
+    if(NOT cmd_res EQUAL 0)
+        message(FATAL_ERROR "Compression at level 9 with ${CPU_PATH} code path failed with code ${cmd_res}")
+    endif()
+
+    execute_process(
+        COMMAND ${CMAKE_COMMAND} -E compare_files "buffer_scalar.bin" "buffer_squeezed.bin"
+        RESULT_VARIABLE diff_res
+    )
+    if(diff_res)
+        message(FATAL_ERROR "FAILURE: Output from ${CPU_PATH} code path differs from scalar!")
+    else()
+        message(STATUS "Success: output from ${CPU_PATH} code path is the same as scalar.")
+    endif()
+endforeach()
+
+# 3. An unknown code path is rejected
+execute_process(
+    COMMAND ${GKCOMP} -cpu mmx -level 9 "buffer_original.txt" "buffer_squeezed.bin"
+    RESULT_VARIABLE cmd_res
+    ERROR_VARIABLE comp_stderr
+)
+if(cmd_res EQUAL 0 OR NOT comp_stderr MATCHES "Unrecognised CPU code path 'mmx'")
+    message(FATAL_ERROR "Failure: unknown code path accepted. Received: '${comp_stderr}'")
+else()
+    message(STATUS "Success: unknown code path rejected.")
+endif()
+
+# 4. A code path can only be chosen where the match search is used
+foreach(CPU_TOOL_ARGS "${GKCOMP};-cpu;scalar;buffer_original.txt;buffer_squeezed.bin" "${GKDECOMP};-cpu;scalar;buffer_squeezed.bin;buffer_restored.txt")
+    execute_process(
+        COMMAND ${CPU_TOOL_ARGS}
+        OUTPUT_QUIET
+        ERROR_QUIET
+        RESULT_VARIABLE cmd_res
+    )
+    if(cmd_res EQUAL 0)
+        message(FATAL_ERROR "Failure: '${CPU_TOOL_ARGS}' was unexpectedly accepted")
+    endif()
+endforeach()
+message(STATUS "Success: -cpu rejected where it has no effect.")
+
+# Clean up files from this stage
+file(REMOVE "buffer_squeezed.bin" "buffer_restored.txt" "buffer_scalar.bin")
+
+# =====================================================================
+# STAGE 30: Streaming decompression
+# =====================================================================
+message(STATUS "Starting Streaming Decompression Verification...")
+
+execute_process(
+    COMMAND ${GKCOMP} "buffer_original.txt" "buffer_squeezed.bin"
+    RESULT_VARIABLE cmd_res
+)
+if(NOT cmd_res EQUAL 0)
+    message(FATAL_ERROR "Compression failed with code ${cmd_res}")
+endif()
+
+# 1. Streamed output is complete and time to first byte is reported
+execute_process(
+    COMMAND ${GKDECOMP} -stream -verbose "buffer_squeezed.bin" "buffer_restored.txt"
+    OUTPUT_VARIABLE decomp_stdout
+    RESULT_VARIABLE cmd_res
+)
+execute_process(
+    COMMAND ${CMAKE_COMMAND} -E compare_files "buffer_original.txt" "buffer_restored.txt"
+    RESULT_VARIABLE diff_res
+)
+if(NOT cmd_res EQUAL 0 OR diff_res)
+    message(FATAL_ERROR "FAILURE: File corruption detected in streamed output!")
+endif()
+
+if(NOT decomp_stdout MATCHES "Time to first byte: [0-9]+ ms")
+    message(FATAL_ERROR "Failure: time to first byte not reported. Received: '${decomp_stdout}'")
+else()
+    message(STATUS "Success: streamed output verified.")
+endif()
+
+# 2. Output is written while the rest of the input is still to come. The
+#    writer holds the pipe open until output appears (or 30 seconds pass),
+#    so the result does not depend on how quickly the decompressor runs.
+if(CMAKE_HOST_UNIX)
+    file(REMOVE "buffer_restored.txt")
+    execute_process(
+        COMMAND sh -c "exec 3>&1; { head -c 300 buffer_squeezed.bin; i=0; while [ ! -s buffer_restored.txt ] && [ $i -lt 300 ]; do sleep 0.1; i=$((i+1)); done; wc -c < buffer_restored.txt >&3 2>/dev/null || echo 0 >&3; tail -c +301 buffer_squeezed.bin; } | \"$1\" -stream > buffer_restored.txt" sh "${GKDECOMP}"
+        OUTPUT_VARIABLE early_size
+        RESULT_VARIABLE cmd_res
+    )
+    string(STRIP "${early_size}" early_size)
+    execute_process(
+        COMMAND ${CMAKE_COMMAND} -E compare_files "buffer_original.txt" "buffer_restored.txt"
+        RESULT_VARIABLE diff_res
+    )
+    if(NOT cmd_res EQUAL 0 OR diff_res)
+        message(FATAL_ERROR "FAILURE: File corruption detected in streamed output from a pipe!")
+    endif()
+
+    if(NOT early_size GREATER 0)
+        message(FATAL_ERROR "Failure: no output before the end of the input. Received: '${early_size}'")
+    else()
+        message(STATUS "Success: ${early_size} bytes streamed before the end of the input.")
+    endif()
+endif()
+
+# Clean up files from this stage
+file(REMOVE "buffer_squeezed.bin" "buffer_restored.txt")
+
+# =====================================================================
+# STAGE 31: Estimation of compressed size
+# =====================================================================
+message(STATUS "Starting Size Estimation Verification...")
+
+# 1. A table is printed for each history size, without writing a file
+execute_process(
+    COMMAND ${GKCOMP} -estimate "buffer_original.txt"
+    OUTPUT_VARIABLE estimate_stdout
+    RESULT_VARIABLE cmd_res
+)
+if(NOT cmd_res EQUAL 0)
+    message(FATAL_ERROR "Estimation failed with code ${cmd_res}")
+endif()
+
+if(NOT estimate_stdout MATCHES "Estimated compression of 'buffer_original.txt'" OR
+   NOT estimate_stdout MATCHES "\n      0 \\|" OR
+   NOT estimate_stdout MATCHES "\n     12 \\| +[0-9.]+ \\| +[0-9.]+ \\| +[0-9.]+ \\| +[0-9.]+ - +[0-9.]+ \\| +[0-9]+")
+    message(FATAL_ERROR "Failure: estimate table not printed. Received: '${estimate_stdout}'")
+else()
+    message(STATUS "Success: estimate table printed.")
+endif()
+
+# 2. One history size can be chosen
+execute_process(
+    COMMAND ${GKCOMP} -estimate -history 14 "buffer_original.txt"
+    OUTPUT_VARIABLE estimate_stdout
+    RESULT_VARIABLE cmd_res
+)
+if(NOT cmd_res EQUAL 0 OR NOT estimate_stdout MATCHES "\n     14 \\|" OR
+   estimate_stdout MATCHES "\n     12 \\|")
+    message(FATAL_ERROR "Failure: estimate for one history size. Received: '${estimate_stdout}'")
+else()
+    message(STATUS "Success: estimate for one history size printed.")
+endif()
+
+# 3. Estimation cannot be combined with writing output
+foreach(BAD_ARGS "-estimate;-batch;buffer_original.txt" "-estimate;-outfile;buffer_squeezed.bin;buffer_original.txt" "-estimate" "-estimate;-history;17;buffer_original.txt")
+    execute_process(
+        COMMAND ${GKCOMP} ${BAD_ARGS}
+        OUTPUT_QUIET
+        ERROR_QUIET
+        RESULT_VARIABLE cmd_res
+    )
+    if(cmd_res EQUAL 0)
+        message(FATAL_ERROR "Failure: '${BAD_ARGS}' was unexpectedly accepted")
+    endif()
+endforeach()
+
+if(EXISTS "buffer_squeezed.bin")
+    message(FATAL_ERROR "Failure: an output file was written in estimation mode")
+endif()
+message(STATUS "Success: invalid use of -estimate rejected.")
+
+# 4. The estimated interval holds the size of output from the same model
+#    applied to the whole file. The corpus mixes blocks that compress well,
+#    moderately and not at all, and is too big to be parsed in full, so the
+#    estimate comes from a sample. The interval only covers the error due to
+#    sampling: level 8 searches the whole history like the estimator's greedy
+#    parse, but also tries the next position before copying, which usually
+#    makes its output a little smaller. GKeyLib's own parse differs more, so
+#    its size is only reported.
+set(CORPUS "")
+foreach(i RANGE 1 48)
+    math(EXPR CORPUS_KIND "${i} % 3")
+    math(EXPR CORPUS_SEED "3100 + ${i}")
+    if(CORPUS_KIND EQUAL 0)
+        string(RANDOM LENGTH 4096 RANDOM_SEED ${CORPUS_SEED} CORPUS_PART)
+    elseif(CORPUS_KIND EQUAL 1)
+        string(RANDOM LENGTH 4096 ALPHABET "etaoin shrdlu" RANDOM_SEED ${CORPUS_SEED} CORPUS_PART)
+    else()
+        string(RANDOM LENGTH 64 RANDOM_SEED ${CORPUS_SEED} CORPUS_WORD)
+        string(REPEAT "${CORPUS_WORD}${TEXT_BLOCK}" 28 CORPUS_PART)
+    endif()
+    string(APPEND CORPUS "${CORPUS_PART}")
+endforeach()
+file(WRITE "buffer_corpus.txt" "${CORPUS}")
+file(SIZE "buffer_corpus.txt" CORPUS_SIZE)
+
+foreach(EST_HIST 0 9 12)
+    execute_process(
+        COMMAND ${GKCOMP} -estimate -history ${EST_HIST} "buffer_corpus.txt"
+        OUTPUT_VARIABLE estimate_stdout
+        RESULT_VARIABLE cmd_res
+    )
+    if(NOT cmd_res EQUAL 0 OR NOT estimate_stdout MATCHES
+       "\n +${EST_HIST} \\| +[0-9.]+ \\| +[0-9.]+ \\| +[0-9.]+ \\| +([0-9]+)\\.([0-9][0-9]) - +([0-9]+)\\.([0-9][0-9]) \\|")
+        message(FATAL_ERROR "Failure: no estimate for history ${EST_HIST}. Received: '${estimate_stdout}'")
+    endif()
+
+    # Compare percentages in hundredths, as printed
+    math(EXPR EST_LOW "${CMAKE_MATCH_1} * 100 + 1${CMAKE_MATCH_2} - 100")
+    math(EXPR EST_HIGH "${CMAKE_MATCH_3} * 100 + 1${CMAKE_MATCH_4} - 100")
+
+    # Allow lazy matching to save up to a twentieth of the model's output
+    math(EXPR EST_LAZY_LOW "${EST_LOW} - ${EST_LOW} / 20")
+
+    foreach(EST_TOOL "level 8" "GKeyLib")
+        if(EST_TOOL STREQUAL "GKeyLib")
+            set(EST_ARGS "")
+            set(EST_REPORT "Note")
+        else()
+            set(EST_ARGS -level 8)
+            set(EST_REPORT "Success")
+        endif()
+
+        execute_process(
+            COMMAND ${GKCOMP} ${EST_ARGS} -history ${EST_HIST} "buffer_corpus.txt" "buffer_squeezed.bin"
+            RESULT_VARIABLE cmd_res
+        )
+        if(NOT cmd_res EQUAL 0)
+            message(FATAL_ERROR "Compression using ${EST_TOOL} with history ${EST_HIST} failed with code ${cmd_res}")
+        endif()
+
+        file(SIZE "buffer_squeezed.bin" ACTUAL_SIZE)
+        math(EXPR ACTUAL_RATIO "(${ACTUAL_SIZE} * 10000 + ${CORPUS_SIZE} / 2) / ${CORPUS_SIZE}")
+
+        if(ACTUAL_RATIO LESS EST_LAZY_LOW OR ACTUAL_RATIO GREATER EST_HIGH)
+            if(EST_TOOL STREQUAL "GKeyLib")
+                message(STATUS "Note: GKeyLib ratio ${ACTUAL_RATIO} (hundredths of a percent) is outside the estimated interval ${EST_LOW} - ${EST_HIGH} for history ${EST_HIST}, allowing for its different parse")
+            else()
+                message(FATAL_ERROR "Failure: ${EST_TOOL} ratio ${ACTUAL_RATIO} (hundredths of a percent) is outside the estimated interval ${EST_LOW} - ${EST_HIGH} for history ${EST_HIST}, allowing down to ${EST_LAZY_LOW} for lazy matching")
+            endif()
+        else()
+            message(STATUS "${EST_REPORT}: ${EST_TOOL} ratio ${ACTUAL_RATIO} (hundredths of a percent) is within the estimated interval ${EST_LOW} - ${EST_HIGH} for history ${EST_HIST}")
+        endif()
+    endforeach()
+endforeach()
+
+# Clean up files from this stage
+file(REMOVE "buffer_corpus.txt" "buffer_squeezed.bin")
+
+# =====================================================================
+# STAGE 32: Compression levels
+# =====================================================================
+message(STATUS "Starting Compression Level Verification...")
+
+# 1. Output at every level is decompressed by GKeyLib without loss, and
+#    higher levels are no bigger than level 1
+foreach(LEVEL_HIST 0 9 12)
+    unset(LEVEL_1_SIZE)
+    foreach(LEVEL RANGE 1 9)
+        execute_process(
+            COMMAND ${GKCOMP} -level ${LEVEL} -history ${LEVEL_HIST} "buffer_original.txt" "buffer_squeezed.bin"
+            RESULT_VARIABLE cmd_res
+        )
+        if(NOT cmd_res EQUAL 0)
+            message(FATAL_ERROR "Compression at level ${LEVEL} with history ${LEVEL_HIST} failed with code ${cmd_res}")
+        endif()
+
+        execute_process(
+            COMMAND ${GKDECOMP} -history ${LEVEL_HIST} "buffer_squeezed.bin" "buffer_restored.txt"
+            RESULT_VARIABLE cmd_res
+        )
+        if(NOT cmd_res EQUAL 0)
+            message(FATAL_ERROR "Decompression at level ${LEVEL} with history ${LEVEL_HIST} failed with code ${cmd_res}")
+        endif()
+
+        execute_process(
+            COMMAND ${CMAKE_COMMAND} -E compare_files "buffer_original.txt" "buffer_restored.txt"
+            RESULT_VARIABLE diff_res
+        )
+        if(diff_res)
+            message(FATAL_ERROR "FAILURE: File corruption detected at level ${LEVEL} with history ${LEVEL_HIST}!")
+        endif()
+
+        file(SIZE "buffer_squeezed.bin" LEVEL_SIZE)
+        if(NOT DEFINED LEVEL_1_SIZE)
+            set(LEVEL_1_SIZE ${LEVEL_SIZE})
+        elseif(LEVEL_SIZE GREATER LEVEL_1_SIZE)
+            message(FATAL_ERROR "Failure: level ${LEVEL} output (${LEVEL_SIZE} bytes) is bigger than level 1 (${LEVEL_1_SIZE} bytes)")
+        endif()
+    endforeach()
+    message(STATUS "SUCCESS: Lossless match verified at every level with history ${LEVEL_HIST}")
+endforeach()
+
+# 2. Output to a pipe, where the uncompressed size is written first
+execute_process(
+    COMMAND ${GKCOMP} -level 5 "buffer_original.txt"
+    COMMAND ${GKDECOMP}
+    OUTPUT_FILE "buffer_restored.txt"
+    RESULT_VARIABLE cmd_res
+)
+execute_process(
+    COMMAND ${CMAKE_COMMAND} -E compare_files "buffer_original.txt" "buffer_restored.txt"
+    RESULT_VARIABLE diff_res
+)
+if(NOT cmd_res EQUAL 0 OR diff_res)
+    message(FATAL_ERROR "FAILURE: File corruption detected when compressing at a level to a pipe!")
+else()
+    message(STATUS "SUCCESS: Lossless match verified when compressing at a level to a pipe")
+endif()
+
+# 3. Levels are only accepted by gkcomp, and within range
+foreach(BAD_ARGS "-level;0;buffer_original.txt;buffer_squeezed.bin" "-level;10;buffer_original.txt;buffer_squeezed.bin" "-level;5;-history;17;buffer_original.txt;buffer_squeezed.bin" "-level;5;-estimate;buffer_original.txt")
+    execute_process(
+        COMMAND ${GKCOMP} ${BAD_ARGS}
+        OUTPUT_QUIET
+        ERROR_QUIET
+        RESULT_VARIABLE cmd_res
+    )
+    if(cmd_res EQUAL 0)
+        message(FATAL_ERROR "Failure: '${BAD_ARGS}' was unexpectedly accepted")
+    endif()
+endforeach()
+
+execute_process(
+    COMMAND ${GKDECOMP} -level 5 "buffer_squeezed.bin" "buffer_restored.txt"
+    OUTPUT_QUIET
+    ERROR_QUIET
+    RESULT_VARIABLE cmd_res
+)
+if(cmd_res EQUAL 0)
+    message(FATAL_ERROR "Failure: gkdecomp unexpectedly accepted -level")
+endif()
+message(STATUS "Success: invalid use of -level rejected.")
+
+# Clean up files from this stage
+file(REMOVE "buffer_squeezed.bin" "buffer_restored.txt")
+
+# =====================================================================
+# STAGE 33: Compression from checkpoints
+# =====================================================================
+message(STATUS "Starting Checkpoint Verification...")
+
+# A corpus big enough for several checkpoints, which compresses moderately
+set(CHECK_CORPUS "")
+foreach(i RANGE 1 72)
+    math(EXPR CHECK_SEED "3300 + ${i}")
+    string(RANDOM LENGTH 4096 ALPHABET "etaoin shrdlu" RANDOM_SEED ${CHECK_SEED} CHECK_PART)
+    string(APPEND CHECK_CORPUS "${CHECK_PART}")
+endforeach()
+
+# An edited version with a change in the middle and more data at the end
+string(SUBSTRING "${CHECK_CORPUS}" 0 200000 CHECK_HEAD)
+string(SUBSTRING "${CHECK_CORPUS}" 200003 -1 CHECK_TAIL)
+set(CHECK_EDITED "${CHECK_HEAD}XYZ${CHECK_TAIL}${TEXT_BLOCK}${TEXT_BLOCK}")
+
+file(WRITE "buffer_check_1.txt" "${CHECK_CORPUS}")
+file(WRITE "buffer_check_2.txt" "${CHECK_EDITED}")
+file(REMOVE "buffer_checkpoints.bin")
+
+# 1. Output with checkpoints is the same as without them, whether or not
+#    the checkpoints are from an earlier version of the input, a different
+#    history size, or the same input
+foreach(CHECK_STEP "buffer_check_1.txt;12;" "buffer_check_2.txt;12;Reusing [1-9]" "buffer_check_2.txt;9;Ignoring" "buffer_check_2.txt;9;Reusing [1-9]" "buffer_check_1.txt;9;")
+    list(GET CHECK_STEP 0 CHECK_INPUT)
+    list(GET CHECK_STEP 1 CHECK_HIST)
+    list(GET CHECK_STEP 2 CHECK_EXPECT)
+
+    execute_process(
+        COMMAND ${GKCOMP} -level 5 -history ${CHECK_HIST} "${CHECK_INPUT}" "buffer_expected.bin"
+        RESULT_VARIABLE cmd_res
+    )
+    if(NOT cmd_res EQUAL 0)
+        message(FATAL_ERROR "Compression of ${CHECK_INPUT} failed with code ${cmd_res}")
+    endif()
+
+    execute_process(
+        COMMAND ${GKCOMP} -level 5 -history ${CHECK_HIST} -checkpoints "buffer_checkpoints.bin" -verbose "${CHECK_INPUT}" "buffer_squeezed.bin"
+        OUTPUT_VARIABLE check_out
+        RESULT_VARIABLE cmd_res
+    )
+    if(NOT cmd_res EQUAL 0)
+        message(FATAL_ERROR "Compression of ${CHECK_INPUT} with checkpoints failed with code ${cmd_res}")
+    endif()
+    if(NOT check_out MATCHES "${CHECK_EXPECT}")
+        message(FATAL_ERROR "Failure: compressing ${CHECK_INPUT} with history ${CHECK_HIST} did not report '${CHECK_EXPECT}':\n${check_out}")
+    endif()
+
+    execute_process(
+        COMMAND ${CMAKE_COMMAND} -E compare_files "buffer_expected.bin" "buffer_squeezed.bin"
+        RESULT_VARIABLE diff_res
+    )
+    if(diff_res)
+        message(FATAL_ERROR "FAILURE: Output from checkpoints differs when compressing ${CHECK_INPUT} with history ${CHECK_HIST}!")
+    endif()
+endforeach()
+message(STATUS "SUCCESS: Output from checkpoints matches output without them")
+
+# 2. The output can be decompressed as usual
+execute_process(
+    COMMAND ${GKDECOMP} -history 9 "buffer_squeezed.bin" "buffer_restored.txt"
+    RESULT_VARIABLE cmd_res
+)
+execute_process(
+    COMMAND ${CMAKE_COMMAND} -E compare_files "buffer_check_1.txt" "buffer_restored.txt"
+    RESULT_VARIABLE diff_res
+)
+if(NOT cmd_res EQUAL 0 OR diff_res)
+    message(FATAL_ERROR "FAILURE: File corruption detected when compressing from checkpoints!")
+else()
+    message(STATUS "SUCCESS: Lossless match verified when compressing from checkpoints")
+endif()
+
+# 3. Checkpoints are only accepted with a level, for a single file
+foreach(BAD_ARGS "-checkpoints;buffer_checkpoints.bin;buffer_check_1.txt;buffer_squeezed.bin" "-level;5;-checkpoints;buffer_checkpoints.bin;-batch;buffer_squeezed.bin" "-level;5;-checkpoints")
+    execute_process(
+        COMMAND ${GKCOMP} ${BAD_ARGS}
+        OUTPUT_QUIET
+        ERROR_QUIET
+        RESULT_VARIABLE cmd_res
+    )
+    if(cmd_res EQUAL 0)
+        message(FATAL_ERROR "Failure: '${BAD_ARGS}' was unexpectedly accepted")
+    endif()
+endforeach()
+message(STATUS "Success: invalid use of -checkpoints rejected.")
+
+# Clean up files from this stage
+file(REMOVE "buffer_check_1.txt" "buffer_check_2.txt" "buffer_checkpoints.bin" "buffer_expected.bin" "buffer_squeezed.bin" "buffer_restored.txt")
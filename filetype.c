@@ -18,13 +18,28 @@
  *  Foundation, Inc., 675 Mass Ave, Cambridge, MA 02139, USA.
  */
 
+#if !defined(ACORN_C) && !defined(_WIN32)
+#define _POSIX_C_SOURCE 200809L
+#endif
+
 /* ISO library header files */
 #include <assert.h>
 #include <stdbool.h>
+#include <stdio.h>
+#include <time.h>
 
 #ifdef ACORN_C
 /* RISC OS header files */
 #include "kernel.h"
+#elif defined(_WIN32)
+#include <io.h>
+#include <sys/stat.h>
+#include <windows.h>
+#else
+/* POSIX header files */
+#include <fcntl.h>
+#include <sys/stat.h>
+#include <unistd.h>
 #endif
 
 /* Local headers */
@@ -55,3 +70,90 @@ bool set_file_type(const char *file_path, bool compressed)
   return true;
 #endif
 }
+
+/* Platform-specific function */
+bool can_make_holes(FILE *f)
+{
+#ifdef ACORN_C
+  NOT_USED(f);
+  return false;
+#elif defined(_WIN32)
+  struct _stat64 st;
+  const long int pos = ftell(f);
+
+  assert(f != NULL);
+  return pos >= 0 && !_fstat64(_fileno(f), &st) &&
+         (st.st_mode & _S_IFMT) == _S_IFREG && st.st_size == pos;
+#else
+  struct stat st;
+  const long int pos = ftell(f);
+  int flags;
+
+  assert(f != NULL);
+
+  /* In append mode, every write goes to the end of the file regardless
+     of the file position */
+  flags = fcntl(fileno(f), F_GETFL);
+  if (flags == -1 || (flags & O_APPEND))
+    return false;
+
+  /* If there is already data beyond the file position then it would not
+     be overwritten by seeking */
+  return pos >= 0 && !fstat(fileno(f), &st) && S_ISREG(st.st_mode) &&
+         st.st_size == pos;
+#endif
+}
+
+/* Platform-specific function */
+bool set_file_size(FILE *f, long int size)
+{
+  assert(f != NULL);
+  assert(size >= 0);
+
+  if (fflush(f))
+    return false;
+
+#ifdef ACORN_C
+  NOT_USED(size);
+  return false;
+#elif defined(_WIN32)
+  return _chsize_s(_fileno(f), size) == 0;
+#else
+  return ftruncate(fileno(f), size) == 0;
+#endif
+}
+
+/* Platform-specific function */
+unsigned long long clock_us(void)
+{
+#ifdef ACORN_C
+  /* Elapsed real time since the program started */
+  return (unsigned long long)clock() * 1000000u / CLOCKS_PER_SEC;
+#elif defined(_WIN32)
+  static LARGE_INTEGER frequency;
+  LARGE_INTEGER count;
+
+  if (frequency.QuadPart == 0)
+    QueryPerformanceFrequency(&frequency);
+
+  QueryPerformanceCounter(&count);
+  return (unsigned long long)(count.QuadPart / frequency.QuadPart) *
+           1000000u +
+         (unsigned long long)(count.QuadPart % frequency.QuadPart) *
+           1000000u / (unsigned long long)frequency.QuadPart;
+#else
+  struct timespec ts;
+
+#ifdef CLOCK_MONOTONIC
+  if (clock_gettime(CLOCK_MONOTONIC, &ts) &&
+      clock_gettime(CLOCK_REALTIME, &ts))
+    return 0;
+#else
+  if (clock_gettime(CLOCK_REALTIME, &ts))
+    return 0;
+#endif
+
+  return (unsigned long long)ts.tv_sec * 1000000u +
+         (unsigned long long)ts.tv_nsec / 1000u;
+#endif
+}
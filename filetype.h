@@ -8,7 +8,21 @@
 #define FILETYPE_H
 
 #include <stdbool.h>
+#include <stdio.h>
 
 bool set_file_type(const char *file_path, bool compressed);
 
+/* Find out whether seeking forward in a stream and then writing will leave
+   a hole that reads as zeros (i.e. it is a regular file being written at
+   its end, not in append mode). */
+bool can_make_holes(FILE *f);
+
+/* Truncate or extend a file to the given size, in bytes. */
+bool set_file_size(FILE *f, long int size);
+
+/* Get a time in microseconds, for measuring intervals. It is monotonic
+   wherever the platform offers such a clock; otherwise it is the time of
+   day, never processor time. */
+unsigned long long clock_us(void);
+
 #endif /* FILETYPE_H */
@@ -0,0 +1,500 @@
+/*
+ *  Gordon Key file compression utilities
+ *  Benchmark program entry point
+ *  Copyright (C) 2026 Christopher Bazley
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public Licence as published by
+ *  the Free Software Foundation; either version 2 of the Licence, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public Licence for more details.
+ *
+ *  You should have received a copy of the GNU General Public Licence
+ *  along with this program; if not, write to the Free Software
+ *  Foundation, Inc., 675 Mass Ave, Cambridge, MA 02139, USA.
+ */
+
+/* ISO library header files */
+#include <assert.h>
+#include <errno.h>
+#include <stdbool.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+/* CBUtilLib headers */
+#include "ArgUtils.h"
+#include "StrExtra.h"
+
+/* GKeyLib headers */
+#include "GKeyComp.h"
+
+/* Local headers */
+#include "gkcpu.h"
+#include "gkencoder.h"
+#include "gkestimate.h"
+#include "gkmatch.h"
+#include "gkparse.h"
+#include "misc.h"
+#include "version.h"
+
+enum {
+  HISTORY_SIZE = 1 << GKMATCH_SPECIALISED_MAX_LOG_2,
+  DEFAULT_SIZE = 16 * 1024, /* Default no. of bytes of input to search */
+  MAX_SIZE = 16 * 1024 * 1024,
+  MIN_CLOCKS = CLOCKS_PER_SEC / 4, /* Minimum time to repeat each search */
+  DEFAULT_LEVELS_LOG_2 = 9, /* Default history size for -levels */
+  FEDNET_HEADER_SIZE = 4, /* No. of bytes in a 32 bit integer */
+  BUFFER_SIZE = 4096 /* Output buffer size, in bytes */
+};
+
+typedef GKMatch FindFn(const unsigned char *data, size_t avail,
+                       unsigned int history_log_2);
+
+static unsigned long parse(const unsigned char *data, size_t size,
+                           unsigned int history_log_2, FindFn *find)
+{
+  /* Find matches in the same order as a greedy compressor, and return the
+     number of bits that it would output */
+  unsigned long nbits = 0;
+  size_t pos = 0;
+
+  while (pos < size) {
+    const GKMatch match = find(data + pos, size - pos, history_log_2);
+    const unsigned int copy_bits =
+      match.length > 0 ? gkmatch_copy_bits(match.distance, history_log_2) : 0;
+
+    if (match.length > 0 && copy_bits < GKMATCH_LITERAL_BITS * match.length) {
+      nbits += copy_bits;
+      pos += match.length;
+    } else {
+      nbits += GKMATCH_LITERAL_BITS;
+      ++pos;
+    }
+  }
+
+  return nbits;
+}
+
+static double time_parse(const unsigned char *data, size_t size,
+                         unsigned int history_log_2, FindFn *find,
+                         unsigned long *nbits)
+{
+  /* Repeat the search until the time taken can be measured reliably,
+     then return the average number of seconds per repetition */
+  const clock_t start_time = clock();
+  clock_t elapsed;
+  unsigned long count = 0;
+
+  do {
+    *nbits = parse(data, size, history_log_2, find);
+    ++count;
+    elapsed = clock() - start_time;
+  } while (elapsed < MIN_CLOCKS);
+
+  return (double)elapsed / CLOCKS_PER_SEC / count;
+}
+
+static bool encoded_size(const unsigned char *data, size_t size,
+                         unsigned int history_log_2, unsigned int level,
+                         long int *out_size)
+{
+  /* Compress the data at a compression level, discarding the output, and
+     get the size of the file that would be written, including the header */
+  char out_buffer[BUFFER_SIZE];
+  _Optional GKEncoder *const enc = gkencoder_make(history_log_2, level);
+  GKeyStatus status;
+
+  if (enc == NULL) {
+    fprintf(stderr, "Failed to allocate memory: %s\n", strerror(errno));
+    return false;
+  }
+
+  GKeyParameters params = {
+    .in_buffer = data,
+    .in_size = size,
+    .out_buffer = out_buffer,
+    .out_size = sizeof(out_buffer),
+  };
+
+  *out_size = FEDNET_HEADER_SIZE;
+
+  do {
+    status = gkencoder_compress(&*enc, &params);
+
+    if (status == GKeyStatus_Finished || status == GKeyStatus_BufferOverflow ||
+        params.out_size == 0) {
+      *out_size += (long int)(sizeof(out_buffer) - params.out_size);
+      params.out_buffer = out_buffer;
+      params.out_size = sizeof(out_buffer);
+
+      if (status == GKeyStatus_BufferOverflow)
+        status = GKeyStatus_OK;
+    }
+  } while (status == GKeyStatus_OK);
+
+  gkencoder_destroy(enc);
+
+  if (status != GKeyStatus_Finished) {
+    fprintf(stderr, "Failed to compress at level %u\n", level);
+    return false;
+  }
+  return true;
+}
+
+static double time_level(const unsigned char *data, size_t size,
+                         unsigned int history_log_2, unsigned int level,
+                         long int *out_size)
+{
+  /* As time_parse, but compressing the data at a compression level.
+     Returns a negative value on failure. */
+  const clock_t start_time = clock();
+  clock_t elapsed;
+  unsigned long count = 0;
+
+  do {
+    if (!encoded_size(data, size, history_log_2, level, out_size))
+      return -1.0;
+    ++count;
+    elapsed = clock() - start_time;
+  } while (elapsed < MIN_CLOCKS);
+
+  return (double)elapsed / CLOCKS_PER_SEC / count;
+}
+
+static void make_data(unsigned char *data, size_t size)
+{
+  /* Text with occasional typos, to break up long matches */
+  static const char text[] =
+    "Acorn RISC OS Fourth Dimension FedNet Chocks Away Stunt Racer "
+    "Star Fighter GKeyLib. ";
+  unsigned long seed = 1;
+  size_t i;
+
+  for (i = 0; i < size; ++i) {
+    seed = (seed * 1103515245ul + 12345ul) & 0x7ffffffful;
+    data[i] = (seed >> 16) % 64 ? (unsigned char)text[i % (sizeof(text) - 1)]
+                                : (unsigned char)(seed >> 8);
+  }
+}
+
+static bool bench(const unsigned char *data, size_t size,
+                  unsigned int history_log_2)
+{
+  unsigned long generic_bits, specialised_bits;
+  const double generic_time = time_parse(data, size, history_log_2,
+                                         gkmatch_find_generic, &generic_bits);
+  const double specialised_time =
+    time_parse(data, size, history_log_2, gkmatch_find, &specialised_bits);
+
+  printf("%7u | %15.3f | %15.3f | %6.2f | %6.2f\n", history_log_2,
+         generic_time * 1000, specialised_time * 1000,
+         specialised_time > 0 ? generic_time / specialised_time : 0.0,
+         (double)(specialised_bits + 7) / 8 * 100 / size);
+
+  if (generic_bits != specialised_bits) {
+    fprintf(stderr, "Output size mismatch for history %u\n", history_log_2);
+    return false;
+  }
+  return true;
+}
+
+static bool bench_levels(const unsigned char *data, size_t size,
+                         unsigned int history_log_2)
+{
+  unsigned int level;
+
+  printf("Compression levels over %lu bytes with history %u "
+         "(times in milliseconds)\n\n"
+         "Level | Candidates | Lazy |            Time |  Ratio\n"
+         "------|------------|------|-----------------|-------\n",
+         (unsigned long)size, history_log_2);
+
+  for (level = GKPARSE_MIN_LEVEL; level <= GKPARSE_MAX_LEVEL; ++level) {
+    const GKParseLevel *const strategy = gkparse_level(level);
+    long int out_size;
+    const double time =
+      time_level(data, size, history_log_2, level, &out_size);
+    unsigned long nbits;
+
+    if (time < 0)
+      return false;
+
+    if (strategy->max_candidates > 0)
+      printf("%5u | %10u |", level, strategy->max_candidates);
+    else
+      printf("%5u | %10s |", level, "all");
+
+    printf(" %4u | %15.3f | %6.2f\n", strategy->lazy, time * 1000,
+           (double)out_size * 100 / size);
+
+    /* The output should be exactly the size predicted by the parser */
+    nbits = gkparse_bits(data, size, history_log_2, level);
+    if (out_size != FEDNET_HEADER_SIZE + (long int)((nbits + 7) / 8)) {
+      fprintf(stderr, "Output size mismatch for level %u\n", level);
+      return false;
+    }
+  }
+  return true;
+}
+
+static bool compressed_size(const unsigned char *data, size_t size,
+                            unsigned int history_log_2, long int *out_size)
+{
+  /* Compress the data with GKeyLib, discarding the output, and get the
+     size of the file that would be written, including the header */
+  char out_buffer[BUFFER_SIZE];
+  _Optional GKeyComp *const comp = gkeycomp_make(history_log_2);
+  GKeyStatus status;
+
+  if (comp == NULL) {
+    fprintf(stderr, "Failed to allocate memory: %s\n", strerror(errno));
+    return false;
+  }
+
+  GKeyParameters params = {
+    .in_buffer = data,
+    .in_size = size,
+    .out_buffer = out_buffer,
+    .out_size = sizeof(out_buffer),
+  };
+
+  *out_size = FEDNET_HEADER_SIZE;
+
+  do {
+    status = gkeycomp_compress(&*comp, &params);
+
+    if (status == GKeyStatus_Finished || status == GKeyStatus_BufferOverflow ||
+        params.out_size == 0) {
+      *out_size += (long int)(sizeof(out_buffer) - params.out_size);
+      params.out_buffer = out_buffer;
+      params.out_size = sizeof(out_buffer);
+
+      if (status == GKeyStatus_BufferOverflow)
+        status = GKeyStatus_OK;
+    }
+  } while (status == GKeyStatus_OK || status == GKeyStatus_TruncatedInput);
+
+  gkeycomp_destroy(comp);
+
+  if (status != GKeyStatus_Finished) {
+    fprintf(stderr, "Failed to compress with history %u\n", history_log_2);
+    return false;
+  }
+  return true;
+}
+
+static bool bench_estimate(const unsigned char *data, size_t size,
+                           unsigned int min_log_2, unsigned int max_log_2)
+{
+  /* Compare the estimate from a sample with the same model applied to all
+     of the data, and with the output of GKeyLib itself */
+  GKEstimate estimates[GKESTIMATE_MAX_LOG_2 + 1];
+  unsigned int h;
+
+  if (size == 0) {
+    fputs("Cannot estimate compression of empty input\n", stderr);
+    return false;
+  }
+
+  if (!gkestimate_buffer(data, size, min_log_2, max_log_2, estimates))
+    return false;
+
+  printf("Estimated compression of %lu bytes (%ld sampled, "
+         "ratios in percent)\n\n"
+         "History | Estimate |     95%% interval |  Model | Actual | Inside\n"
+         "--------|----------|------------------|--------|--------|-------\n",
+         (unsigned long)size, estimates[0].sampled);
+
+  for (h = min_log_2; h <= max_log_2; ++h) {
+    const GKEstimate *const e = &estimates[h - min_log_2];
+    GKParseStats stats = {0, 0, 0};
+    long int actual;
+    double actual_ratio;
+
+    if (!compressed_size(data, size, h, &actual))
+      return false;
+
+    gkparse_greedy(data, size, h, &stats);
+    actual_ratio = (double)actual * 100 / size;
+
+    printf("%7u | %8.2f | %7.2f - %7.2f | %6.2f | %6.2f | %6s\n", h, e->ratio,
+           e->ratio_low, e->ratio_high,
+           (FEDNET_HEADER_SIZE + (double)(stats.bits + 7) / 8) * 100 / size,
+           actual_ratio,
+           actual_ratio >= e->ratio_low && actual_ratio <= e->ratio_high
+             ? "yes"
+             : "no");
+  }
+  return true;
+}
+
+static _Optional unsigned char *load_file(const char *file_name,
+                                          size_t *size)
+{
+  /* Read up to *size bytes of input after a zeroed history buffer */
+  _Optional unsigned char *buffer = NULL;
+  _Optional FILE *f = fopen(file_name, "rb");
+
+  if (f == NULL) {
+    fprintf(stderr, "Failed to open input file: %s\n", strerror(errno));
+  } else {
+    buffer = calloc(HISTORY_SIZE + *size, 1);
+    if (buffer == NULL) {
+      fprintf(stderr, "Failed to allocate memory: %s\n", strerror(errno));
+    } else {
+      *size = fread(&*buffer + HISTORY_SIZE, 1, *size, &*f);
+      if (ferror(&*f)) {
+        fprintf(stderr, "Failed to read from input file: %s\n",
+                strerror(errno));
+        free(buffer);
+        buffer = NULL;
+      }
+    }
+    fclose(&*f);
+  }
+  return buffer;
+}
+
+static int syntax_msg(FILE *f, const char *path)
+{
+  const char *leaf;
+
+  assert(f != NULL);
+  assert(path != NULL);
+
+  leaf = strtail(path, PATH_SEPARATOR, 1);
+  fprintf(f,
+          "usage: %s [switches] [inputfile]\n"
+          "If no input file is specified, it uses generated text.\n"
+          "Switches (names may be abbreviated):\n"
+          "  -help               Display this text\n"
+          "  -cpu name           Use no faster code path than name\n"
+          "  -estimate           Check size estimates against GKeyLib instead\n"
+          "  -history N          Only benchmark one history size\n"
+          "  -levels             Benchmark compression levels instead\n"
+          "  -size N             No. of bytes of input to search\n",
+          leaf);
+  return EXIT_FAILURE;
+}
+
+int main(int argc, const char *argv[])
+{
+  int n, rtn = EXIT_SUCCESS;
+  size_t size = DEFAULT_SIZE;
+  long int history_log_2 = -1;
+  bool levels = false, estimate = false;
+  _Optional const char *cpu = NULL;
+  _Optional unsigned char *buffer;
+
+  assert(argc > 0);
+  assert(argv != NULL);
+
+  for (n = 1; n < argc && argv[n][0] == '-'; n++) {
+    const char *opt = argv[n] + 1;
+
+    if (is_switch(opt, "help", 2)) {
+      puts("Gordon Key file compression benchmark, " VERSION_STRING);
+      (void)syntax_msg(stdout, argv[0]);
+      return EXIT_SUCCESS;
+    } else if (is_switch(opt, "cpu", 1)) {
+      if (++n >= argc || argv[n][0] == '-') {
+        fputs("Missing code path name\n", stderr);
+        return syntax_msg(stderr, argv[0]);
+      }
+      cpu = argv[n];
+    } else if (is_switch(opt, "estimate", 1)) {
+      estimate = true;
+    } else if (is_switch(opt, "history", 2)) {
+      if (!get_long_arg("history", &history_log_2, 0,
+                        GKMATCH_SPECIALISED_MAX_LOG_2, argc, argv, ++n)) {
+        return syntax_msg(stderr, argv[0]);
+      }
+    } else if (is_switch(opt, "levels", 1)) {
+      levels = true;
+    } else if (is_switch(opt, "size", 1)) {
+      long int num;
+      if (!get_long_arg("size", &num, 1, MAX_SIZE, argc, argv, ++n)) {
+        return syntax_msg(stderr, argv[0]);
+      }
+      size = (size_t)num;
+    } else {
+      fprintf(stderr, "Unrecognised switch '%s'\n", opt);
+      return syntax_msg(stderr, argv[0]);
+    }
+  }
+
+  if (n < argc - 1) {
+    fputs("Too many arguments\n", stderr);
+    return syntax_msg(stderr, argv[0]);
+  }
+
+  if (n < argc) {
+    buffer = load_file(argv[n], &size);
+  } else {
+    buffer = calloc(HISTORY_SIZE + size, 1);
+    if (buffer != NULL)
+      make_data(&*buffer + HISTORY_SIZE, size);
+    else
+      fprintf(stderr, "Failed to allocate memory: %s\n", strerror(errno));
+  }
+
+  if (buffer == NULL)
+    return EXIT_FAILURE;
+
+  if (!gkcpu_init(cpu)) {
+    free(buffer);
+    return EXIT_FAILURE;
+  }
+
+  gkmatch_select();
+  gkcpu_report(stdout);
+  putchar('\n');
+
+  if (estimate) {
+    if (history_log_2 >= 0) {
+      if (!bench_estimate(&*buffer + HISTORY_SIZE, size,
+                          (unsigned int)history_log_2,
+                          (unsigned int)history_log_2))
+        rtn = EXIT_FAILURE;
+    } else if (!bench_estimate(&*buffer + HISTORY_SIZE, size, 0,
+                               GKMATCH_SIMD_MAX_LOG_2)) {
+      rtn = EXIT_FAILURE;
+    }
+    free(buffer);
+    return rtn;
+  }
+
+  if (levels) {
+    if (!bench_levels(&*buffer + HISTORY_SIZE, size,
+                      history_log_2 >= 0 ? (unsigned int)history_log_2
+                                         : DEFAULT_LEVELS_LOG_2))
+      rtn = EXIT_FAILURE;
+    free(buffer);
+    return rtn;
+  }
+
+  printf("Match search over %lu bytes (times in milliseconds)\n\n"
+         "History |         Generic |     Specialised |  Speed |  Ratio\n"
+         "--------|-----------------|-----------------|--------|-------\n",
+         (unsigned long)size);
+
+  if (history_log_2 >= 0) {
+    if (!bench(&*buffer + HISTORY_SIZE, size, (unsigned int)history_log_2))
+      rtn = EXIT_FAILURE;
+  } else {
+    unsigned int h;
+    for (h = 0; h <= GKMATCH_SPECIALISED_MAX_LOG_2; ++h) {
+      if (!bench(&*buffer + HISTORY_SIZE, size, h))
+        rtn = EXIT_FAILURE;
+    }
+  }
+
+  free(buffer);
+  return rtn;
+}
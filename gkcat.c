@@ -0,0 +1,461 @@
+/*
+ *  Gordon Key file compression utilities
+ *  Concatenation program entry point
+ *  Copyright (C) 2026 Christopher Bazley
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public Licence as published by
+ *  the Free Software Foundation; either version 2 of the Licence, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public Licence for more details.
+ *
+ *  You should have received a copy of the GNU General Public Licence
+ *  along with this program; if not, write to the Free Software
+ *  Foundation, Inc., 675 Mass Ave, Cambridge, MA 02139, USA.
+ */
+
+#ifdef _WIN32
+#include <io.h>     /* Required for _setmode and _fileno */
+#include <fcntl.h>  /* Required for _O_BINARY */
+#endif
+
+/* ISO library header files */
+#include <assert.h>
+#include <errno.h>
+#include <stdbool.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#ifdef GKEY_THREADS
+/* POSIX header files */
+#include <pthread.h>
+#endif
+
+/* CBUtilLib headers */
+#include "ArgUtils.h"
+#include "StrExtra.h"
+
+/* Local headers */
+#include "gkdecoder.h"
+#ifdef GKEY_THREADS
+#include "gkpipe.h"
+#endif
+#include "gktrace.h"
+#include "misc.h"
+#include "version.h"
+
+/* Constant numeric values */
+enum {
+  FEDNET_COMP_LOG_2 = 9, /* Base 2 logarithm of the history size used by The
+                            Fourth Dimension and Fednet games, in bytes */
+  MAX_HISTORY_LOG_2 = 31,
+  CHUNK_SIZE = 65536,    /* No. of bytes of decompressed data per chunk */
+  NCHUNKS = 4,           /* No. of chunks to read ahead for each file */
+  READ_AHEAD = 4         /* No. of files to decompress at once */
+};
+
+typedef struct {
+  unsigned int history_log_2;
+  _Optional const char *separator; /* Line to write between files */
+  bool prefix;                     /* Prefix each line with the file name */
+} CatOptions;
+
+typedef struct {
+  const char *file_name;
+  const CatOptions *options;
+  _Optional FILE *in;
+  _Optional GKDecoder *dec;
+  long int expected;
+  long int actual;  /* No. of bytes decompressed, if not the expected size */
+  bool bad_size;
+  bool open_failed;
+  int open_error;   /* Value of errno if the file could not be opened */
+#ifdef GKEY_THREADS
+  _Optional GKPipe *pipe;
+  pthread_t thread;
+  bool started;
+#endif
+} Job;
+
+static bool start_file(Job *job)
+{
+  /* Open a compressed file and read its header */
+  assert(job != NULL);
+
+  job->in = fopen(job->file_name, "rb");
+  if (job->in == NULL) {
+    job->open_failed = true;
+    job->open_error = errno;
+    return false;
+  }
+
+  if (!gkdecoder_read_size(&*job->in, &job->expected))
+    return false;
+
+  job->dec = gkdecoder_make(&*job->in, job->options->history_log_2);
+  if (job->dec == NULL) {
+    fprintf(stderr, "Failed to allocate memory: %s\n", strerror(errno));
+    return false;
+  }
+
+  return true;
+}
+
+static bool finish_file(Job *job, bool success, bool stopped)
+{
+  /* Check that the file was the expected size and close it. The result is
+     recorded for report_file rather than reported here, because this may
+     run on a thread that is reading ahead. */
+  assert(job != NULL);
+
+  if (success && !stopped && job->dec != NULL &&
+      gkdecoder_out_total(&*job->dec) != job->expected) {
+    job->actual = gkdecoder_out_total(&*job->dec);
+    job->bad_size = true;
+    success = false;
+  }
+
+  gkdecoder_destroy(job->dec);
+  job->dec = NULL;
+
+  if (job->in != NULL) {
+    fclose(&*job->in);
+    job->in = NULL;
+  }
+
+  return success && !stopped;
+}
+
+static void report_file(const Job *job, bool success)
+{
+  /* Report a failure when the file's turn to be written comes, so that
+     messages are in the same order as the files. A file that was stopped
+     before the end (e.g. after a write error) is not reported as having
+     failed to decompress. */
+  assert(job != NULL);
+
+  if (job->open_failed || job->bad_size || !success)
+    fflush(stdout);
+
+  if (job->open_failed) {
+    fprintf(stderr, "Failed to open input file '%s': %s\n", job->file_name,
+            strerror(job->open_error));
+  }
+
+  if (job->bad_size) {
+    fprintf(stderr, "Decompressed %ld bytes but expected %ld\n",
+            job->actual, job->expected);
+  }
+
+  if (!success)
+    fprintf(stderr, "Failed to decompress '%s'\n", job->file_name);
+}
+
+static bool write_data(const char *data, size_t size, const Job *job,
+                       bool *line_start)
+{
+  /* Write decompressed data to stdout, optionally with the file name at
+     the start of each line */
+  size_t start = 0;
+
+  assert(data != NULL || size == 0);
+  assert(job != NULL);
+  assert(line_start != NULL);
+
+  if (!job->options->prefix) {
+    if (fwrite(data, 1, size, stdout) != size) {
+      fprintf(stderr, "Failed to write %lu bytes to output: %s\n",
+              (unsigned long)size, strerror(errno));
+      return false;
+    }
+    return true;
+  }
+
+  while (start < size) {
+    const _Optional char *const newline =
+      memchr(data + start, '\n', size - start);
+    const size_t end =
+      newline != NULL ? (size_t)(newline - data) + 1 : size;
+
+    if (*line_start && fprintf(stdout, "%s:", job->file_name) < 0) {
+      fprintf(stderr, "Failed to write to output: %s\n", strerror(errno));
+      return false;
+    }
+
+    if (fwrite(data + start, 1, end - start, stdout) != end - start) {
+      fprintf(stderr, "Failed to write %lu bytes to output: %s\n",
+              (unsigned long)(end - start), strerror(errno));
+      return false;
+    }
+
+    *line_start = newline != NULL;
+    start = end;
+  }
+
+  return true;
+}
+
+static bool cat_now(Job *job, bool *write_ok)
+{
+  /* Decompress a file and write it without reading ahead */
+  static char buffer[CHUNK_SIZE];
+  bool success = start_file(job), line_start = true;
+
+  while (success && *write_ok && !gkdecoder_finished(&*job->dec)) {
+    size_t size = 0;
+    success = gkdecoder_read(&*job->dec, buffer, sizeof(buffer), &size);
+    if (success)
+      *write_ok = write_data(buffer, size, job, &line_start);
+  }
+
+  success = finish_file(job, success, !*write_ok);
+  if (*write_ok)
+    report_file(job, success);
+
+  return success;
+}
+
+#ifdef GKEY_THREADS
+
+static void *decoder_thread(void *arg)
+{
+  /* Decompress a file into chunks to be written by the main thread */
+  Job *const job = arg;
+  bool success, cancelled = false;
+
+  GKTRACE_THREAD("decoder");
+
+  assert(job->pipe != NULL);
+  success = start_file(job);
+
+  while (success && !cancelled && !gkdecoder_finished(&*job->dec)) {
+    _Optional GKChunk *const chunk = gkpipe_claim(&*job->pipe);
+    if (chunk == NULL) {
+      cancelled = true; /* Cancelled by the main thread */
+    } else {
+      success = gkdecoder_read(&*job->dec, chunk->data, chunk->capacity,
+                               &chunk->size);
+      if (success)
+        gkpipe_send(&*job->pipe);
+    }
+  }
+
+  /* Check the size of the data before telling the main thread whether
+     the file was decompressed successfully. The main thread reports any
+     failure in its turn. */
+  success = finish_file(job, success, cancelled);
+  gkpipe_close(&*job->pipe, success);
+  return NULL;
+}
+
+static void start_job(Job *job)
+{
+  /* Start decompressing a file on another thread. If that isn't possible
+     then it will be decompressed later, without reading ahead. */
+  assert(job != NULL);
+
+  job->pipe = gkpipe_make(NCHUNKS, CHUNK_SIZE);
+  if (job->pipe != NULL) {
+    job->started = !pthread_create(&job->thread, NULL, decoder_thread, job);
+    if (!job->started) {
+      gkpipe_destroy(job->pipe);
+      job->pipe = NULL;
+    }
+  }
+}
+
+static bool finish_job(Job *job, bool *write_ok)
+{
+  /* Write a file's decompressed data, in order, as it becomes available */
+  _Optional GKChunk *chunk;
+  bool success, line_start = true;
+
+  assert(job != NULL);
+
+  if (!job->started)
+    return *write_ok && cat_now(job, write_ok);
+
+  while (*write_ok && (chunk = gkpipe_receive(&*job->pipe)) != NULL) {
+    *write_ok = write_data(chunk->data, chunk->size, job, &line_start);
+    gkpipe_release(&*job->pipe);
+  }
+
+  if (*write_ok) {
+    success = gkpipe_succeeded(&*job->pipe);
+  } else {
+    gkpipe_cancel(&*job->pipe);
+    success = false;
+  }
+
+  pthread_join(job->thread, NULL);
+  gkpipe_destroy(job->pipe);
+  job->pipe = NULL;
+  job->started = false;
+
+  if (*write_ok)
+    report_file(job, success);
+
+  return success;
+}
+
+static bool cat_files(Job *jobs, int njobs)
+{
+  /* Keep up to READ_AHEAD files decompressing ahead of the one being
+     written */
+  bool success = true, write_ok = true;
+  int next = 0, i;
+
+  for (i = 0; i < njobs && write_ok; ++i) {
+    for (; next < njobs && next < i + READ_AHEAD; ++next)
+      start_job(&jobs[next]);
+
+    if (!finish_job(&jobs[i], &write_ok))
+      success = false;
+
+    if (write_ok && i + 1 < njobs && jobs[i].options->separator != NULL) {
+      if (fprintf(stdout, "%s\n", &*jobs[i].options->separator) < 0) {
+        fprintf(stderr, "Failed to write to output: %s\n", strerror(errno));
+        write_ok = false;
+      }
+    }
+  }
+
+  /* Stop any files still being read ahead after a write error */
+  for (; i < next; ++i) {
+    if (jobs[i].started) {
+      gkpipe_cancel(&*jobs[i].pipe);
+      pthread_join(jobs[i].thread, NULL);
+      gkpipe_destroy(jobs[i].pipe);
+    }
+  }
+
+  return success && write_ok;
+}
+
+#else /* GKEY_THREADS */
+
+static bool cat_files(Job *jobs, int njobs)
+{
+  /* Decompress each file in turn */
+  bool success = true, write_ok = true;
+  int i;
+
+  for (i = 0; i < njobs && write_ok; ++i) {
+    if (!cat_now(&jobs[i], &write_ok))
+      success = false;
+
+    if (write_ok && i + 1 < njobs && jobs[i].options->separator != NULL) {
+      if (fprintf(stdout, "%s\n", &*jobs[i].options->separator) < 0) {
+        fprintf(stderr, "Failed to write to output: %s\n", strerror(errno));
+        write_ok = false;
+      }
+    }
+  }
+
+  return success && write_ok;
+}
+
+#endif /* GKEY_THREADS */
+
+static int syntax_msg(FILE *f, const char *path)
+{
+  const char *leaf;
+
+  assert(f != NULL);
+  assert(path != NULL);
+
+  leaf = strtail(path, PATH_SEPARATOR, 1);
+  fprintf(f,
+          "usage: %s [switches] file1 [file2 file3 .. fileN]\n"
+          "Writes the decompressed contents of each file to stdout.\n"
+          "Switches (names may be abbreviated):\n"
+          "  -help               Display this text\n"
+          "  -history N          History buffer size as a base 2 logarithm\n"
+          "  -prefix             Prefix each line with the file name\n"
+          "  -separator text     Write a line of text between files\n",
+          leaf);
+  return EXIT_FAILURE;
+}
+
+int main(int argc, const char *argv[])
+{
+  CatOptions options = {
+    .history_log_2 = FEDNET_COMP_LOG_2,
+    .separator = NULL,
+    .prefix = false,
+  };
+  _Optional Job *jobs;
+  int n, i, rtn = EXIT_SUCCESS;
+
+  assert(argc > 0);
+  assert(argv != NULL);
+
+  DEBUG_SET_OUTPUT(DebugOutput_StdErr, "");
+  GKTRACE_START();
+
+  for (n = 1; n < argc && argv[n][0] == '-'; n++) {
+    const char *opt = argv[n] + 1;
+
+    if (is_switch(opt, "help", 2)) {
+      puts("Gordon Key file concatenation utility, " VERSION_STRING "\n"
+           "Copyright (C) 2026, Christopher Bazley");
+      (void)syntax_msg(stdout, argv[0]);
+      return EXIT_SUCCESS;
+    } else if (is_switch(opt, "history", 2)) {
+      long int num;
+      if (!get_long_arg("history", &num, 0, MAX_HISTORY_LOG_2, argc, argv,
+                        ++n)) {
+        return syntax_msg(stderr, argv[0]);
+      }
+      options.history_log_2 = (unsigned int)num;
+    } else if (is_switch(opt, "prefix", 1)) {
+      options.prefix = true;
+    } else if (is_switch(opt, "separator", 1)) {
+      if (++n >= argc) {
+        fputs("Missing separator text\n", stderr);
+        return syntax_msg(stderr, argv[0]);
+      }
+      options.separator = argv[n];
+    } else {
+      fprintf(stderr, "Unrecognised switch '%s'\n", opt);
+      return syntax_msg(stderr, argv[0]);
+    }
+  }
+
+  if (n >= argc) {
+    fputs("Must specify file(s) to decompress\n", stderr);
+    return syntax_msg(stderr, argv[0]);
+  }
+
+  jobs = calloc((size_t)(argc - n), sizeof(*jobs));
+  if (jobs == NULL) {
+    fprintf(stderr, "Failed to allocate memory: %s\n", strerror(errno));
+    return EXIT_FAILURE;
+  }
+
+  for (i = 0; i < argc - n; ++i) {
+    jobs[i].file_name = argv[n + i];
+    jobs[i].options = &options;
+  }
+
+#ifdef _WIN32
+  /* Force binary mode on Windows to prevent corruption */
+  _setmode(_fileno(stdout), _O_BINARY);
+#endif
+
+  if (!cat_files(&*jobs, argc - n))
+    rtn = EXIT_FAILURE;
+
+  if (fflush(stdout)) {
+    fprintf(stderr, "Failed to write to output: %s\n", strerror(errno));
+    rtn = EXIT_FAILURE;
+  }
+
+  free(jobs);
+  return rtn;
+}
@@ -0,0 +1,627 @@
+/*
+ *  Gordon Key file compression utilities
+ *  Incremental compression from saved encoder checkpoints
+ *  Copyright (C) 2026 Christopher Bazley
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public Licence as published by
+ *  the Free Software Foundation; either version 2 of the Licence, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public Licence for more details.
+ *
+ *  You should have received a copy of the GNU General Public Licence
+ *  along with this program; if not, write to the Free Software
+ *  Foundation, Inc., 675 Mass Ave, Cambridge, MA 02139, USA.
+ */
+
+/* ISO library header files */
+#include <assert.h>
+#include <errno.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+/* CBUtilLib headers */
+#include "FileRWInt.h"
+
+/* GKeyLib headers */
+#include "GKeyComp.h"
+
+/* Local headers */
+#include "gkcheckpoint.h"
+#include "gkencoder.h"
+#include "gkparse.h"
+#include "gktrace.h"
+#include "misc.h"
+
+enum {
+  BLOCK_SIZE = 65536,  /* No. of bytes of input per hash, which is also the
+                          least input between checkpoints */
+  BUFFER_SIZE = 65536, /* I/O buffer size, in bytes */
+  HASH_SIZE = 8,       /* No. of bytes in each stored hash */
+  FORMAT_ID = 0x4B434B47, /* "GKCK" as a little-endian integer */
+  FORMAT_VERSION = 1,
+  HEADER_SIZE = 8 * 4  /* No. of bytes in eight 32 bit integers */
+};
+
+/* The checkpoint file holds a header, the compressed data (without the
+   uncompressed size), a hash of each block of the input, and the
+   checkpoints. The header holds FORMAT_ID, FORMAT_VERSION, the history size,
+   the level, BLOCK_SIZE, the input size, the compressed data size and the
+   no. of checkpoints. */
+
+typedef struct {
+  long int in_offset;    /* No. of bytes of input before the checkpoint */
+  long int out_offset;   /* No. of whole bytes of output before it */
+  unsigned int out_bits; /* No. of bits of output before it in the next
+                            byte */
+} Checkpoint;
+
+typedef struct {
+  long int in_size;      /* No. of bytes of input */
+  long int stream_size;  /* No. of bytes of compressed data */
+  size_t nblocks;        /* No. of elements of 'hashes' */
+  size_t ncheckpoints;   /* No. of elements of 'checkpoints' in use */
+  _Optional unsigned long long *hashes;
+  _Optional Checkpoint *checkpoints; /* In order of input offset, with room
+                                        for one per block and one more */
+} Record;
+
+static unsigned long long hash_block(const unsigned char *data, size_t n)
+{
+  /* 64 bit FNV-1a */
+  unsigned long long hash = 0xCBF29CE484222325ull;
+  size_t i;
+
+  for (i = 0; i < n; ++i) {
+    hash ^= data[i];
+    hash *= 0x100000001B3ull;
+  }
+  return hash & 0xFFFFFFFFFFFFFFFFull; /* in case long long is wider */
+}
+
+static bool write_hash(unsigned long long hash, FILE *f)
+{
+  unsigned char bytes[HASH_SIZE];
+  int i;
+
+  for (i = 0; i < HASH_SIZE; ++i)
+    bytes[i] = (unsigned char)(hash >> (8 * i));
+
+  return fwrite(bytes, sizeof(bytes), 1, f) == 1;
+}
+
+static bool read_hash(unsigned long long *hash, FILE *f)
+{
+  unsigned char bytes[HASH_SIZE];
+  int i;
+
+  if (fread(bytes, sizeof(bytes), 1, f) != 1)
+    return false;
+
+  *hash = 0;
+  for (i = 0; i < HASH_SIZE; ++i)
+    *hash |= (unsigned long long)bytes[i] << (8 * i);
+
+  return true;
+}
+
+static size_t block_count(long int size)
+{
+  return (size_t)((size + BLOCK_SIZE - 1) / BLOCK_SIZE);
+}
+
+static size_t block_size(long int size, size_t i)
+{
+  const long int left = size - (long int)i * BLOCK_SIZE;
+  return left < BLOCK_SIZE ? (size_t)left : BLOCK_SIZE;
+}
+
+static bool make_record(Record *rec, long int in_size)
+{
+  /* Allocate the tables for an input of the given size */
+  rec->in_size = in_size;
+  rec->stream_size = 0;
+  rec->nblocks = block_count(in_size);
+  rec->ncheckpoints = 0;
+  rec->hashes = malloc((rec->nblocks + 1) * sizeof(*rec->hashes));
+  rec->checkpoints = malloc((rec->nblocks + 1) * sizeof(*rec->checkpoints));
+  if (rec->hashes == NULL || rec->checkpoints == NULL) {
+    fprintf(stderr, "Failed to allocate memory: %s\n", strerror(errno));
+    return false;
+  }
+  return true;
+}
+
+static void destroy_record(Record *rec)
+{
+  free(rec->checkpoints);
+  free(rec->hashes);
+}
+
+static bool hash_input(FILE *in, Record *rec, unsigned char *buffer)
+{
+  /* Find the size of the input and make a hash of each block of it, then
+     return to the start */
+  long int len;
+  size_t i;
+
+  if (fseek(in, 0, SEEK_END)) {
+    fputs("Checkpoints need an input that can be seeked\n", stderr);
+    return false;
+  }
+
+  len = ftell(in);
+  if (len == -1L) {
+    fprintf(stderr, "Failed to tell input file position\n");
+    return false;
+  }
+
+  if (fseek(in, 0, SEEK_SET)) {
+    fprintf(stderr, "Failed to seek start of input\n");
+    return false;
+  }
+
+  if (!make_record(rec, len))
+    return false;
+
+  for (i = 0; i < rec->nblocks; ++i) {
+    const size_t n = block_size(len, i);
+
+    if (fread(buffer, 1, n, in) != n) {
+      fprintf(stderr, "Failed to read uncompressed data from input: %s\n",
+              ferror(in) ? strerror(errno) : "unexpected end of file");
+      return false;
+    }
+    assert(rec->hashes != NULL);
+    rec->hashes[i] = hash_block(buffer, n);
+  }
+  return true;
+}
+
+static _Optional FILE *load_record(const char *file_name,
+                                   unsigned int history_log_2,
+                                   unsigned int level, Record *rec,
+                                   bool verbose)
+{
+  /* Read the tables from a checkpoint file and return it, or NULL if there
+     are no usable checkpoints */
+  _Optional FILE *f = fopen(file_name, "rb");
+  long int fields[HEADER_SIZE / 4];
+  bool valid = true;
+  size_t i;
+
+  if (f == NULL) {
+    if (verbose)
+      printf("No checkpoints in '%s'\n", file_name);
+    return NULL;
+  }
+
+  for (i = 0; i < sizeof(fields) / sizeof(fields[0]) && valid; ++i)
+    valid = fread_int32le(&fields[i], &*f);
+
+  if (valid && (fields[0] != FORMAT_ID || fields[1] != FORMAT_VERSION ||
+                fields[4] != BLOCK_SIZE || fields[5] < 0 || fields[6] < 0 ||
+                fields[7] < 1)) {
+    valid = false;
+  }
+
+  if (valid && ((unsigned long)fields[2] != history_log_2 ||
+                (unsigned long)fields[3] != level)) {
+    if (verbose)
+      printf("Ignoring checkpoints for a different history size or level\n");
+    fclose(&*f);
+    return NULL;
+  }
+
+  if (valid) {
+    valid = make_record(rec, fields[5]);
+    rec->stream_size = fields[6];
+    if (valid && (unsigned long)fields[7] > rec->nblocks + 1)
+      valid = false;
+  }
+
+  if (valid && fseek(&*f, HEADER_SIZE + rec->stream_size, SEEK_SET))
+    valid = false;
+
+  for (i = 0; i < rec->nblocks && valid; ++i) {
+    assert(rec->hashes != NULL);
+    valid = read_hash(&rec->hashes[i], &*f);
+  }
+
+  for (i = 0; valid && i < (size_t)fields[7]; ++i) {
+    long int in_offset, out_offset, out_bits;
+    Checkpoint *const c = &rec->checkpoints[i];
+
+    valid = fread_int32le(&in_offset, &*f) &&
+            fread_int32le(&out_offset, &*f) &&
+            fread_int32le(&out_bits, &*f) && in_offset >= 0 &&
+            in_offset <= rec->in_size && out_offset >= 0 &&
+            out_offset + (out_bits > 0) <= rec->stream_size &&
+            out_bits >= 0 && out_bits < 8 &&
+            (i == 0 ? in_offset == 0 && out_offset == 0 && out_bits == 0
+                    : in_offset > c[-1].in_offset);
+    if (valid) {
+      c->in_offset = in_offset;
+      c->out_offset = out_offset;
+      c->out_bits = (unsigned int)out_bits;
+      rec->ncheckpoints = i + 1;
+    }
+  }
+
+  if (!valid) {
+    if (verbose)
+      printf("Ignoring invalid checkpoint file '%s'\n", file_name);
+    fclose(&*f);
+    return NULL;
+  }
+
+  return f;
+}
+
+static bool save_record(FILE *f, const Record *rec,
+                        unsigned int history_log_2, unsigned int level)
+{
+  /* Add the tables after the compressed data, then fill in the header */
+  const long int fields[HEADER_SIZE / 4] = {
+    FORMAT_ID, FORMAT_VERSION, (long int)history_log_2, (long int)level,
+    BLOCK_SIZE, rec->in_size, rec->stream_size, (long int)rec->ncheckpoints
+  };
+  bool success = true;
+  size_t i;
+
+  for (i = 0; i < rec->nblocks && success; ++i) {
+    assert(rec->hashes != NULL);
+    success = write_hash(rec->hashes[i], f);
+  }
+
+  for (i = 0; i < rec->ncheckpoints && success; ++i) {
+    const Checkpoint *const c = &rec->checkpoints[i];
+    success = fwrite_int32le(c->in_offset, f) &&
+              fwrite_int32le(c->out_offset, f) &&
+              fwrite_int32le((long int)c->out_bits, f);
+  }
+
+  if (success && fseek(f, 0, SEEK_SET))
+    success = false;
+
+  for (i = 0; i < sizeof(fields) / sizeof(fields[0]) && success; ++i)
+    success = fwrite_int32le(fields[i], f);
+
+  return success;
+}
+
+static size_t find_resume(const Record *old, const Record *rec,
+                          size_t lookahead)
+{
+  /* Find the last checkpoint before which the output cannot depend on any
+     changed input. The choice of directive at a position depends on the
+     input up to the lookahead beyond it. */
+  size_t nsame = 0, k = 0;
+  long int unchanged;
+
+  while (nsame < old->nblocks && nsame < rec->nblocks &&
+         old->hashes[nsame] == rec->hashes[nsame] &&
+         block_size(old->in_size, nsame) == block_size(rec->in_size, nsame))
+    ++nsame;
+
+  if (nsame == rec->nblocks && old->in_size == rec->in_size)
+    unchanged = rec->in_size;
+  else
+    unchanged = (long int)nsame * BLOCK_SIZE;
+
+  while (k + 1 < old->ncheckpoints &&
+         old->checkpoints[k + 1].in_offset + (long int)lookahead <= unchanged)
+    ++k;
+
+  return k;
+}
+
+static bool write_both(const void *data, size_t n, FILE *out, FILE *copy)
+{
+  if (fwrite(data, 1, n, out) != n || fwrite(data, 1, n, copy) != n) {
+    fprintf(stderr, "Failed to write %lu bytes to output: %s\n",
+            (unsigned long)n, strerror(errno));
+    return false;
+  }
+  return true;
+}
+
+static bool copy_prefix(FILE *from, const Checkpoint *c, FILE *out,
+                        FILE *copy, unsigned char *buffer,
+                        unsigned int *partial)
+{
+  /* Copy the compressed data before a checkpoint, and get the byte that is
+     only partly before it */
+  long int n = c->out_offset;
+
+  if (fseek(from, HEADER_SIZE, SEEK_SET)) {
+    fputs("Failed to seek compressed data in checkpoint file\n", stderr);
+    return false;
+  }
+
+  while (n > 0) {
+    const size_t chunk = n < BUFFER_SIZE ? (size_t)n : BUFFER_SIZE;
+
+    if (fread(buffer, 1, chunk, from) != chunk) {
+      fputs("Failed to read compressed data from checkpoint file\n", stderr);
+      return false;
+    }
+    if (!write_both(buffer, chunk, out, copy))
+      return false;
+    n -= (long int)chunk;
+  }
+
+  *partial = 0;
+  if (c->out_bits > 0) {
+    const int byte = fgetc(from);
+
+    if (byte == EOF) {
+      fputs("Failed to read compressed data from checkpoint file\n", stderr);
+      return false;
+    }
+    *partial = (unsigned int)byte;
+  }
+  return true;
+}
+
+static bool read_history(FILE *in, long int in_offset, unsigned char *history,
+                         size_t window)
+{
+  /* Read the input that precedes a checkpoint into the end of the history
+     buffer, leaving the input positioned at the checkpoint */
+  const size_t n = (unsigned long)in_offset < window ? (size_t)in_offset
+                                                     : window;
+
+  if (fseek(in, in_offset - (long int)n, SEEK_SET)) {
+    fprintf(stderr, "Failed to seek input at offset %ld\n", in_offset);
+    return false;
+  }
+
+  if (fread(history + window - n, 1, n, in) != n) {
+    fprintf(stderr, "Failed to read uncompressed data from input: %s\n",
+            ferror(in) ? strerror(errno) : "unexpected end of file");
+    return false;
+  }
+  return true;
+}
+
+static bool copy_file(FILE *from, const char *file_name,
+                      unsigned char *buffer)
+{
+  _Optional FILE *to;
+  bool success = true;
+  size_t n;
+
+  if (fseek(from, 0, SEEK_SET)) {
+    fputs("Failed to seek start of temporary file\n", stderr);
+    return false;
+  }
+
+  to = fopen(file_name, "wb");
+  if (to == NULL) {
+    fprintf(stderr, "Failed to open checkpoint file: %s\n", strerror(errno));
+    return false;
+  }
+
+  while (success && (n = fread(buffer, 1, BUFFER_SIZE, from)) > 0) {
+    if (fwrite(buffer, 1, n, &*to) != n)
+      success = false;
+  }
+
+  if (ferror(from) || fclose(&*to))
+    success = false;
+
+  if (!success) {
+    fprintf(stderr, "Failed to write checkpoint file: %s\n", strerror(errno));
+    remove(file_name);
+  }
+  return success;
+}
+
+bool gkcheckpoint_compress(FILE *in, FILE *out, const char *file_name,
+                           unsigned int history_log_2, unsigned int level,
+                           bool verbose)
+{
+  const size_t window = (size_t)1 << history_log_2;
+  Record old = {0, 0, 0, 0, NULL, NULL}, rec = {0, 0, 0, 0, NULL, NULL};
+  _Optional FILE *old_file = NULL, *tmp = NULL;
+  _Optional unsigned char *in_buffer = NULL, *out_buffer = NULL,
+                          *history = NULL;
+  _Optional GKEncoder *enc = NULL;
+  Checkpoint resume = {0, 0, 0};
+  unsigned int partial = 0;
+  long int in_total;
+  bool success = false;
+  GKeyStatus status;
+
+  assert(in != NULL);
+  assert(out != NULL);
+  assert(file_name != NULL);
+  assert(history_log_2 <= GKENCODER_MAX_LOG_2);
+
+  in_buffer = malloc(BUFFER_SIZE);
+  out_buffer = malloc(BUFFER_SIZE);
+  history = calloc(window, 1);
+  enc = gkencoder_make(history_log_2, level);
+  if (in_buffer == NULL || out_buffer == NULL || history == NULL ||
+      enc == NULL) {
+    fprintf(stderr, "Failed to allocate memory: %s\n", strerror(errno));
+    goto cleanup;
+  }
+
+  GKTRACE_BEGIN("hash");
+  success = hash_input(in, &rec, &*in_buffer);
+  GKTRACE_END("hash");
+  if (!success)
+    goto cleanup;
+  success = false;
+
+  old_file = load_record(file_name, history_log_2, level, &old, verbose);
+  if (old_file != NULL) {
+    const size_t k = find_resume(&old, &rec, window + GKPARSE_MAX_LAZY);
+
+    /* Checkpoints before the resumption point are still valid */
+    memcpy(&*rec.checkpoints, &*old.checkpoints,
+           (k + 1) * sizeof(*rec.checkpoints));
+    rec.ncheckpoints = k + 1;
+    resume = old.checkpoints[k];
+  } else {
+    rec.checkpoints[0] = resume;
+    rec.ncheckpoints = 1;
+  }
+
+  /* The new checkpoint file is built separately because the old one is
+     read whilst writing it */
+  tmp = tmpfile();
+  if (tmp == NULL) {
+    fprintf(stderr, "Failed to create temporary checkpoint file: %s\n",
+            strerror(errno));
+    goto cleanup;
+  }
+
+  if (fseek(&*tmp, HEADER_SIZE, SEEK_SET)) {
+    fputs("Failed to seek beyond start of temporary file\n", stderr);
+    goto cleanup;
+  }
+
+  if (verbose)
+    printf("Writing uncompressed size %ld\n", rec.in_size);
+
+  if (!fwrite_int32le(rec.in_size, out)) {
+    fprintf(stderr, "Failed to write uncompressed size: %s\n",
+            strerror(errno));
+    goto cleanup;
+  }
+
+  if (old_file != NULL) {
+    if (verbose) {
+      printf("Reusing %ld bytes of output for %ld bytes of unchanged input\n",
+             resume.out_offset, resume.in_offset);
+    }
+
+    GKTRACE_BEGIN("copy checkpoint");
+    success = copy_prefix(&*old_file, &resume, out, &*tmp, &*in_buffer,
+                          &partial);
+    GKTRACE_END("copy checkpoint");
+    fclose(&*old_file);
+    old_file = NULL;
+    if (!success)
+      goto cleanup;
+    success = false;
+  }
+
+  if (!read_history(in, resume.in_offset, &*history, window))
+    goto cleanup;
+
+  gkencoder_resume(&*enc, &*history + window, (size_t)resume.in_offset,
+                   (size_t)resume.out_offset, resume.out_bits, partial);
+
+  in_total = resume.in_offset;
+  rec.stream_size = resume.out_offset;
+
+  GKeyParameters params = {
+    .out_buffer = &*out_buffer,
+    .out_size = BUFFER_SIZE,
+    .in_size = 0,
+  };
+
+  do {
+    if (params.in_size == 0) {
+      params.in_buffer = &*in_buffer;
+      GKTRACE_BEGIN("read");
+      params.in_size = fread(&*in_buffer, 1, BUFFER_SIZE, in);
+      GKTRACE_END("read");
+      if (params.in_size != BUFFER_SIZE && ferror(in)) {
+        fprintf(stderr, "Failed to read uncompressed data from input: %s\n",
+                strerror(errno));
+        goto cleanup;
+      }
+      in_total += (long int)params.in_size;
+    }
+
+    GKTRACE_BEGIN("compress");
+    status = gkencoder_compress(&*enc, &params);
+    GKTRACE_END("compress");
+
+    if (status == GKeyStatus_OK || status == GKeyStatus_BufferOverflow) {
+      /* Save a checkpoint at the end of the input consumed so far, if at
+         least a block beyond the last one */
+      Checkpoint *const last = &rec.checkpoints[rec.ncheckpoints - 1];
+      size_t in_consumed, out_bytes;
+      unsigned int out_bits;
+
+      gkencoder_tell(&*enc, &in_consumed, &out_bytes, &out_bits);
+      if ((long int)in_consumed >= last->in_offset + BLOCK_SIZE &&
+          rec.ncheckpoints <= rec.nblocks) {
+        last[1].in_offset = (long int)in_consumed;
+        last[1].out_offset = (long int)out_bytes;
+        last[1].out_bits = out_bits;
+        ++rec.ncheckpoints;
+      }
+    }
+
+    if (status == GKeyStatus_Finished ||
+        status == GKeyStatus_BufferOverflow || params.out_size == 0) {
+      const size_t nout = BUFFER_SIZE - params.out_size;
+
+      GKTRACE_BEGIN("write");
+      success = write_both(&*out_buffer, nout, out, &*tmp);
+      GKTRACE_END("write");
+      if (!success)
+        goto cleanup;
+      success = false;
+
+      rec.stream_size += (long int)nout;
+      params.out_buffer = &*out_buffer;
+      params.out_size = BUFFER_SIZE;
+
+      if (status == GKeyStatus_BufferOverflow)
+        status = GKeyStatus_OK;
+    }
+  } while (status == GKeyStatus_OK);
+
+  if (status != GKeyStatus_Finished) {
+    fputs("Failed to compress\n", stderr);
+    goto cleanup;
+  }
+
+  if (in_total != rec.in_size) {
+    fprintf(stderr,
+            "%ld bytes read from input mismatches expected size %ld\n",
+            in_total, rec.in_size);
+    goto cleanup;
+  }
+
+  if (verbose) {
+    printf("Saving %lu checkpoints to '%s'\n",
+           (unsigned long)rec.ncheckpoints, file_name);
+  }
+
+  if (!save_record(&*tmp, &rec, history_log_2, level)) {
+    fprintf(stderr, "Failed to write temporary checkpoint file: %s\n",
+            strerror(errno));
+    goto cleanup;
+  }
+
+  success = copy_file(&*tmp, file_name, &*in_buffer);
+
+cleanup:
+  if (old_file != NULL)
+    fclose(&*old_file);
+  if (tmp != NULL)
+    fclose(&*tmp);
+  gkencoder_destroy(enc);
+  destroy_record(&old);
+  destroy_record(&rec);
+  free(history);
+  free(out_buffer);
+  free(in_buffer);
+  return success;
+}
@@ -0,0 +1,26 @@
+/*
+ *  Gordon Key file compression utilities
+ *  Incremental compression from saved encoder checkpoints
+ *  Copyright (C) 2026 Christopher Bazley
+ */
+
+#ifndef GKCHECKPOINT_H
+#define GKCHECKPOINT_H
+
+/* ISO library header files */
+#include <stdbool.h>
+#include <stdio.h>
+
+/* Compress a seekable input in the same way as gkencoder, writing the
+   uncompressed size followed by the compressed data. Checkpoints of the
+   encoder's state and the output are saved in the named file. If that file
+   already holds checkpoints from compressing an earlier version of the input
+   with the same history size and level, then the output before the first
+   changed byte (less one history size) is copied instead of being
+   compressed again. The output is the same either way. Prints a message and
+   returns false on failure. */
+bool gkcheckpoint_compress(FILE *in, FILE *out, const char *file_name,
+                           unsigned int history_log_2, unsigned int level,
+                           bool verbose);
+
+#endif /* GKCHECKPOINT_H */
@@ -40,23 +40,53 @@
 /* Local headers */
 #include "filetype.h"
 #include "gkcommon.h"
+#include "gkencoder.h"
+#include "gkestimate.h"
+#include "gkmatch.h"
+#include "gkparse.h"
+#include "gktrace.h"
 #include "misc.h"
 
 enum {
   FEDNET_COMP_LOG_2 = 9, /* Base 2 logarithm of the history size used by The
                             Fourth Dimension and Fednet games, in bytes */
   MAX_HISTORY_LOG_2 = 31,
-  BUFFER_SIZE = 256 /* Buffer used when reading temporary file back in */
+  DEFAULT_SKIP_RATIO = 100, /* Skip files that would not get smaller */
+  MAX_SKIP_RATIO = 1000,
+  MAX_SWITCH_NAME = 32, /* Longest switch name that can precede '=' */
+  ESTIMATE_MAX_LOG_2 = GKMATCH_SIMD_MAX_LOG_2, /* Largest history size
+                            estimated by default, beyond which the match
+                            search is much slower */
+  BUFFER_SIZE = 4096 /* Buffer used when reading temporary file back in,
+                        which is also the minimum size of a hole */
 };
 
-static bool fcopy(FILE *in, FILE *out)
+static bool is_zeros(const char *buffer, size_t n)
+{
+  assert(buffer != NULL);
+
+  for (size_t i = 0; i < n; ++i) {
+    if (buffer[i] != '\0')
+      return false;
+  }
+  return true;
+}
+
+static bool fcopy(FILE *in, FILE *out, bool sparse, bool verbose)
 {
   char buffer[BUFFER_SIZE];
-  bool success = true;
+  bool success = true, trailing_hole = false;
+  long int hole_size = 0, size = 0;
 
   assert(in != NULL);
   assert(out != NULL);
 
+  /* Seeking is only safe if it leaves a hole in a file */
+  if (sparse) {
+    size = ftell(out);
+    sparse = size >= 0 && can_make_holes(out);
+  }
+
   do {
     /* Read as much data as possible into the input buffer */
     size_t n = fread(buffer, 1, sizeof(buffer), in);
@@ -70,34 +100,72 @@ static bool fcopy(FILE *in, FILE *out)
       }
     }
 
-    /* Write out the data read into the input buffer */
-    if (n != fwrite(buffer, 1, n, out)) {
+    if (sparse && n == sizeof(buffer) && is_zeros(buffer, n)) {
+      /* Seek over a whole buffer of zeros instead of writing it */
+      if (fseek(out, (long)n, SEEK_CUR)) {
+        fprintf(stderr, "Failed to seek in output file: %s\n",
+                strerror(errno));
+        success = false;
+        break;
+      }
+      hole_size += (long)n;
+      trailing_hole = true;
+    } else if (n != fwrite(buffer, 1, n, out)) {
       /* Not all the data was written */
       fprintf(stderr, "Failed to write %lu bytes to output file: %s\n",
               (unsigned long)n, strerror(errno));
       success = false;
       break;
+    } else if (n > 0) {
+      trailing_hole = false;
     }
+    size += (long)n;
   } while (!feof(in));
 
+  /* A hole at the end of the output only exists once the file size has
+     been set to include it */
+  if (success && trailing_hole && !set_file_size(out, size)) {
+    fprintf(stderr, "Failed to set size of output file: %s\n",
+            strerror(errno));
+    success = false;
+  }
+
+  if (success && verbose && hole_size > 0)
+    printf("Left holes instead of copying %ld bytes of zeros\n", hole_size);
+
   return success;
 }
 
 static bool process_file(_Optional const char *input_file,
                          _Optional const char *output_file,
-                         GKProcessFn *processor, unsigned int history_log_2,
-                         bool verbose, bool time, bool compress)
+                         _Optional FILE *done, GKProcessFn *processor,
+                         const GKOptions *options, bool time, bool compress)
 {
+  /* If 'done' is not NULL then it is a temporary file holding output already
+     produced from the input, to be copied instead of processing the input.
+     It is closed before returning. */
   _Optional FILE *out = NULL, *in = NULL, *tmp = NULL, *actual_out = NULL,
                  *actual_in = NULL;
-  bool success = true;
-
-  if (input_file != NULL) {
+  bool success = true, verbose;
+
+  assert(options != NULL);
+  verbose = options->verbose;
+
+  if (done != NULL) {
+    /* Treat the output already produced as if it were written to a temporary
+       file because the input is also the output */
+    assert(input_file != NULL);
+    assert(output_file != NULL);
+    assert(strcmp(&*output_file, &*input_file) == 0);
+    tmp = done;
+  } else if (input_file != NULL) {
     /* An explicit input file name was specified, so open it */
     if (verbose)
       printf("Opening input file '%s'\n", input_file);
 
+    GKTRACE_BEGIN("open input");
     actual_in = in = fopen(&*input_file, "rb");
+    GKTRACE_END("open input");
     if (in == NULL) {
       fprintf(stderr, "Failed to open input file: %s\n", strerror(errno));
       success = false;
@@ -112,7 +180,7 @@ static bool process_file(_Optional const char *input_file,
     actual_in = stdin;
   }
 
-  if (success) {
+  if (success && tmp == NULL) {
     if (output_file != NULL) {
       if (input_file != NULL && strcmp(&*output_file, &*input_file) == 0) {
         /* Can't overwrite the input file whilst reading from it, so direct
@@ -120,7 +188,9 @@ static bool process_file(_Optional const char *input_file,
         if (verbose)
           puts("Opening temporary output file");
 
+        GKTRACE_BEGIN("open temporary");
         actual_out = tmp = tmpfile();
+        GKTRACE_END("open temporary");
         if (tmp == NULL) {
           fprintf(stderr, "Failed to create temporary output file: %s\n",
                   strerror(errno));
@@ -131,7 +201,9 @@ static bool process_file(_Optional const char *input_file,
         if (verbose)
           printf("Opening output file '%s'\n", output_file);
 
+        GKTRACE_BEGIN("open output");
         actual_out = out = fopen(&*output_file, "wb");
+        GKTRACE_END("open output");
         if (out == NULL) {
           fprintf(stderr, "Failed to open output file: %s\n", strerror(errno));
           success = false;
@@ -150,7 +222,9 @@ static bool process_file(_Optional const char *input_file,
   if (success && actual_in && actual_out) {
     const clock_t start_time = time ? clock() : 0;
 
-    success = processor(&*actual_in, &*actual_out, history_log_2, verbose);
+    GKTRACE_BEGIN("process");
+    success = processor(&*actual_in, &*actual_out, options);
+    GKTRACE_END("process");
 
     if (success && time) {
       printf("Time taken: %.2f seconds\n",
@@ -161,7 +235,9 @@ static bool process_file(_Optional const char *input_file,
   if (in != NULL) {
     if (verbose)
       puts("Closing input file");
+    GKTRACE_BEGIN("close input");
     fclose(&*in);
+    GKTRACE_END("close input");
   }
 
   /* If we wrote to a temporary file then copy it to the real output */
@@ -172,7 +248,9 @@ static bool process_file(_Optional const char *input_file,
         if (verbose)
           printf("Opening output file '%s'\n", output_file);
 
+        GKTRACE_BEGIN("open output");
         actual_out = out = fopen(&*input_file, "wb");
+        GKTRACE_END("open output");
         if (out == NULL) {
           fprintf(stderr, "Failed to open output file: %s\n", strerror(errno));
           success = false;
@@ -191,27 +269,34 @@ static bool process_file(_Optional const char *input_file,
       if (verbose)
         puts("Copying from temporary to final output");
 
+      GKTRACE_BEGIN("copy temporary");
       if (fseek(&*tmp, 0L, SEEK_SET)) {
         fprintf(stderr, "Failed to seek start of temporary file\n");
         success = false;
-      } else if (!fcopy(&*tmp, &*actual_out)) {
+      } else if (!fcopy(&*tmp, &*actual_out, !compress && !options->stream,
+                        verbose)) {
         success = false;
       }
+      GKTRACE_END("copy temporary");
     }
 
     /* Close the temporary file (which also deletes it) */
     if (verbose)
       puts("Closing temporary file");
+    GKTRACE_BEGIN("close temporary");
     fclose(&*tmp);
+    GKTRACE_END("close temporary");
   }
 
   if (out != NULL) {
     if (verbose)
       puts("Closing output file");
+    GKTRACE_BEGIN("close output");
     if (fclose(&*out)) {
       fprintf(stderr, "Failed to close output file: %s\n", strerror(errno));
       success = false;
     }
+    GKTRACE_END("close output");
   }
 
   /* If we know the output file name then we should set its type
@@ -221,10 +306,12 @@ static bool process_file(_Optional const char *input_file,
       if (verbose)
         puts("Setting type of output file");
 
+      GKTRACE_BEGIN("set file type");
       if (!set_file_type(&*output_file, compress)) {
         fputs("Failed to set output file type\n", stderr);
         success = false;
       }
+      GKTRACE_END("set file type");
     }
 
     /* Delete malformed output unless debugging is enabled or
@@ -236,7 +323,49 @@ static bool process_file(_Optional const char *input_file,
   return success;
 }
 
-static int syntax_msg(FILE *f, const char *path)
+static bool is_switch_with_value(const char *opt, const char *name,
+                                 size_t min)
+{
+  /* As is_switch, but allowing the switch name to be followed by '=' and
+     a value */
+  char buffer[MAX_SWITCH_NAME];
+  _Optional const char *const value = strchr(opt, '=');
+  size_t len;
+
+  if (value == NULL)
+    return is_switch(opt, name, min);
+
+  len = (size_t)(value - opt);
+  if (len >= sizeof(buffer))
+    return false;
+
+  memcpy(buffer, opt, len);
+  buffer[len] = '\0';
+  return is_switch(buffer, name, min);
+}
+
+static bool get_skip_ratio(const char *opt, long int *skip_ratio)
+{
+  /* Parse the value (if any) following '=' in a switch */
+  _Optional const char *const value = strchr(opt, '=');
+  char *end;
+
+  if (value == NULL) {
+    *skip_ratio = DEFAULT_SKIP_RATIO;
+    return true;
+  }
+
+  *skip_ratio = strtol(&*value + 1, &end, 10);
+  if (end == &*value + 1 || *end != '\0' || *skip_ratio < 1 ||
+      *skip_ratio > MAX_SKIP_RATIO) {
+    fprintf(stderr, "Compression ratio for skip-incompressible must be a "
+                    "percentage between 1 and %d\n", MAX_SKIP_RATIO);
+    return false;
+  }
+  return true;
+}
+
+static int syntax_msg(FILE *f, const char *path, GKTool tool)
 {
   const char *leaf;
 
@@ -254,11 +383,54 @@ static int syntax_msg(FILE *f, const char *path)
     "Switches (names may be abbreviated):\n"
     "  -help               Display this text\n"
     "  -batch              Process a batch of files (see above)\n"
-    "  -outfile name       Specify name for output file\n"
-    "  -history N          History buffer size as a base 2 logarithm\n"
+    "  -outfile name       Specify name for output file\n",
+    leaf, leaf);
+
+  if (tool == GKTool_Recompress) {
+    fputs("  -from N             Input history size as a base 2 logarithm\n"
+          "  -to N               Output history size as a base 2 logarithm\n",
+          f);
+  } else {
+    fputs("  -history N          History buffer size as a base 2 logarithm\n",
+          f);
+  }
+
+  if (tool == GKTool_Compress) {
+    fprintf(f,
+            "                      (0-%d, or 0-%d with -level or -estimate)\n",
+            MAX_HISTORY_LOG_2, GKENCODER_MAX_LOG_2);
+  }
+
+  if (tool == GKTool_Decompress) {
+    fputs("  -stream             Write output as soon as it is decompressed\n",
+          f);
+  }
+
+  if (tool == GKTool_Compress) {
+    fprintf(f,
+            "  -level N            Compress with effort N (%d-%d) instead of\n"
+            "                      using GKeyLib\n"
+            "  -checkpoints name   With -level, save checkpoints in the named\n"
+            "                      file and reuse those from an earlier\n"
+            "                      version of the input\n"
+            "  -estimate           Estimate the compressed size of the input\n"
+            "                      files from a sample, at history sizes 0-%d\n"
+            "                      unless one is given by -history\n",
+            GKPARSE_MIN_LEVEL, GKPARSE_MAX_LEVEL, ESTIMATE_MAX_LOG_2);
+    fputs("  -skip-incompressible[=ratio]\n"
+          "                      In batch mode, leave files that would not\n"
+          "                      compress to ratio% (default 100) untouched\n"
+          "  -watch dir          Keep compressed copies of the files in dir\n"
+          "                      in the directory given by -outfile\n"
+          "  -cpu name           With -level or -estimate, use no faster\n"
+          "                      code path than name (e.g. scalar)\n",
+          f);
+  }
+
+  fputs(
     "  -time               Show the total time for each file processed\n"
     "  -verbose or -debug  Emit debug information (and keep bad output)\n",
-    leaf, leaf);
+    f);
   return EXIT_FAILURE;
 }
 
@@ -271,24 +443,37 @@ static void check_for_leaks(void)
 #endif
 
 int main_common(int argc, const char *argv[], GKProcessFn *processor,
-                const char *description, bool compress)
+                const char *description, GKTool tool,
+                _Optional const GKCompFeatures *features)
 {
-  int n;
-  bool verbose = false, time = false, batch = false;
+  int n, nfiles = 0, nskipped = 0;
+  long int skip_ratio = 0;
+  bool time = false, batch = false, estimate = false, history_set = false;
   int rtn = EXIT_SUCCESS;
-  _Optional const char *output_file = NULL, *input_file = NULL;
-  unsigned int history_log_2 = FEDNET_COMP_LOG_2;
+  _Optional const char *output_file = NULL, *input_file = NULL,
+                       *watch_dir = NULL, *cpu = NULL;
+  GKOptions options = {
+    .history_log_2 = FEDNET_COMP_LOG_2,
+    .to_history_log_2 = FEDNET_COMP_LOG_2,
+    .level = 0,
+    .verbose = false,
+    .stream = false,
+    .checkpoints = NULL,
+  };
+  const bool compress = tool != GKTool_Decompress;
 
   assert(argc > 0);
   assert(argv != NULL);
   assert(processor);
   assert(description != NULL);
+  assert((features != NULL) == (tool == GKTool_Compress));
 
 #ifdef FORTIFY
   Fortify_EnterScope();
   atexit(check_for_leaks);
 #endif
   DEBUG_SET_OUTPUT(DebugOutput_StdErr, "");
+  GKTRACE_START();
 
   /* Parse any options specified on the command line */
   for (n = 1; n < argc && argv[n][0] == '-'; n++) {
@@ -296,7 +481,7 @@ int main_common(int argc, const char *argv[], GKProcessFn *processor,
 
     if (is_switch(opt, "help", 2)) {
       /* Output version number and usage information */
-      (void)syntax_msg(stdout, argv[0]);
+      (void)syntax_msg(stdout, argv[0], tool);
       return EXIT_SUCCESS;
     } else if (is_switch(opt, "batch", 1)) {
       /* Enable batch processing mode */
@@ -305,37 +490,171 @@ int main_common(int argc, const char *argv[], GKProcessFn *processor,
       /* Output file path was specified */
       if (++n >= argc || argv[n][0] == '-') {
         fputs("Missing output file name\n", stderr);
-        return syntax_msg(stderr, argv[0]);
+        return syntax_msg(stderr, argv[0], tool);
       }
       output_file = argv[n];
-    } else if (is_switch(opt, "history", 2)) {
+    } else if (tool != GKTool_Recompress && is_switch(opt, "history", 2)) {
       long int num;
       if (!get_long_arg("history", &num, 0, MAX_HISTORY_LOG_2, argc, argv,
                         ++n)) {
-        return syntax_msg(stderr, argv[0]);
+        return syntax_msg(stderr, argv[0], tool);
+      }
+      options.history_log_2 = (unsigned int)num;
+      history_set = true;
+    } else if (tool == GKTool_Recompress && is_switch(opt, "from", 1)) {
+      long int num;
+      if (!get_long_arg("from", &num, 0, MAX_HISTORY_LOG_2, argc, argv,
+                        ++n)) {
+        return syntax_msg(stderr, argv[0], tool);
       }
-      history_log_2 = (int)num;
+      options.history_log_2 = (unsigned int)num;
+    } else if (tool == GKTool_Recompress && is_switch(opt, "to", 2)) {
+      long int num;
+      if (!get_long_arg("to", &num, 0, MAX_HISTORY_LOG_2, argc, argv, ++n)) {
+        return syntax_msg(stderr, argv[0], tool);
+      }
+      options.to_history_log_2 = (unsigned int)num;
+    } else if (tool == GKTool_Compress && is_switch(opt, "level", 1)) {
+      long int num;
+      if (!get_long_arg("level", &num, GKPARSE_MIN_LEVEL, GKPARSE_MAX_LEVEL,
+                        argc, argv, ++n)) {
+        return syntax_msg(stderr, argv[0], tool);
+      }
+      options.level = (unsigned int)num;
+    } else if (tool == GKTool_Compress && is_switch(opt, "checkpoints", 2)) {
+      /* Checkpoint file name was specified */
+      if (++n >= argc || argv[n][0] == '-') {
+        fputs("Missing checkpoint file name\n", stderr);
+        return syntax_msg(stderr, argv[0], tool);
+      }
+      options.checkpoints = argv[n];
+    } else if (tool == GKTool_Compress && is_switch(opt, "estimate", 1)) {
+      /* Enable estimation mode */
+      estimate = true;
+    } else if (tool == GKTool_Compress &&
+               is_switch_with_value(opt, "skip-incompressible", 2)) {
+      if (!get_skip_ratio(opt, &skip_ratio))
+        return syntax_msg(stderr, argv[0], tool);
+    } else if (tool == GKTool_Compress && is_switch(opt, "watch", 1)) {
+      /* Source directory to watch was specified */
+      if (++n >= argc || argv[n][0] == '-') {
+        fputs("Missing directory name\n", stderr);
+        return syntax_msg(stderr, argv[0], tool);
+      }
+      watch_dir = argv[n];
+    } else if (tool == GKTool_Decompress && is_switch(opt, "stream", 2)) {
+      /* Enable low-latency output */
+      options.stream = true;
+    } else if (tool == GKTool_Compress && is_switch(opt, "cpu", 1)) {
+      /* Code path to use was specified */
+      if (++n >= argc || argv[n][0] == '-') {
+        fputs("Missing code path name\n", stderr);
+        return syntax_msg(stderr, argv[0], tool);
+      }
+      cpu = argv[n];
     } else if (is_switch(opt, "time", 1)) {
       /* Enable debugging output */
       time = true;
     } else if (is_switch(opt, "verbose", 1) || is_switch(opt, "debug", 1)) {
       /* Enable debugging output */
-      verbose = true;
+      options.verbose = true;
       puts(description);
     } else {
       fprintf(stderr, "Unrecognised switch '%s'\n", opt);
-      return syntax_msg(stderr, argv[0]);
+      return syntax_msg(stderr, argv[0], tool);
     }
   }
 
+  if (options.level > 0 && options.history_log_2 > GKENCODER_MAX_LOG_2) {
+    fprintf(stderr, "Cannot choose a compression level for history sizes "
+                    "above %d\n", GKENCODER_MAX_LOG_2);
+    return syntax_msg(stderr, argv[0], tool);
+  }
+
+  if (options.checkpoints != NULL) {
+    if (options.level == 0) {
+      fputs("Can only save checkpoints with -level\n", stderr);
+      return syntax_msg(stderr, argv[0], tool);
+    }
+    if (batch || estimate || watch_dir != NULL || skip_ratio > 0) {
+      fputs("Can only save checkpoints when compressing a single file\n",
+            stderr);
+      return syntax_msg(stderr, argv[0], tool);
+    }
+  }
+
+  if (estimate || options.level > 0) {
+    assert(features != NULL);
+    if (!features->select_cpu(cpu, options.verbose))
+      return EXIT_FAILURE;
+  } else if (cpu != NULL) {
+    fputs("Can only choose a CPU code path with -level or -estimate\n",
+          stderr);
+    return syntax_msg(stderr, argv[0], tool);
+  }
+
+  if (estimate) {
+    const unsigned int min_log_2 = history_set ? options.history_log_2 : 0,
+                       max_log_2 = history_set ? options.history_log_2
+                                               : ESTIMATE_MAX_LOG_2;
+
+    if (batch || output_file != NULL || watch_dir != NULL || skip_ratio > 0) {
+      fputs("Cannot produce output files in estimation mode\n", stderr);
+      return syntax_msg(stderr, argv[0], tool);
+    }
+    if (options.level > 0) {
+      fputs("Cannot choose a compression level in estimation mode\n", stderr);
+      return syntax_msg(stderr, argv[0], tool);
+    }
+    if (n >= argc) {
+      fputs("Must specify file(s) in estimation mode\n", stderr);
+      return syntax_msg(stderr, argv[0], tool);
+    }
+    if (max_log_2 > GKESTIMATE_MAX_LOG_2) {
+      fprintf(stderr, "Cannot estimate for history sizes above %d\n",
+              GKESTIMATE_MAX_LOG_2);
+      return syntax_msg(stderr, argv[0], tool);
+    }
+
+    assert(features != NULL);
+    for (; n < argc; n++) {
+      assert(argv[n] != NULL);
+      if (!features->estimate(argv[n], min_log_2, max_log_2, time))
+        rtn = EXIT_FAILURE;
+    }
+    return rtn;
+  }
+
+  if (watch_dir != NULL) {
+    if (batch || n < argc) {
+      fputs("Cannot specify files to process in watch mode\n", stderr);
+      return syntax_msg(stderr, argv[0], tool);
+    }
+    if (output_file == NULL) {
+      fputs("Must specify an output directory in watch mode\n", stderr);
+      return syntax_msg(stderr, argv[0], tool);
+    }
+    assert(features != NULL);
+    return features->watch(&*watch_dir, &*output_file, processor, &options,
+                           time)
+             ? EXIT_SUCCESS
+             : EXIT_FAILURE;
+  }
+
+  if (skip_ratio > 0 && !batch) {
+    fputs("Can only skip incompressible files in batch processing mode\n",
+          stderr);
+    return syntax_msg(stderr, argv[0], tool);
+  }
+
   if (batch) {
     if (output_file != NULL) {
       fputs("Cannot specify an output file in batch processing mode\n", stderr);
-      return syntax_msg(stderr, argv[0]);
+      return syntax_msg(stderr, argv[0], tool);
     }
     if (n >= argc) {
       fputs("Must specify file(s) in batch processing mode\n", stderr);
-      return syntax_msg(stderr, argv[0]);
+      return syntax_msg(stderr, argv[0], tool);
     }
   }
 
@@ -343,11 +662,25 @@ int main_common(int argc, const char *argv[], GKProcessFn *processor,
     /* In batch processing mode, there remaining arguments are treated as a
        list of file names (output to input files) */
     for (; n < argc && rtn == EXIT_SUCCESS; n++) {
+      _Optional FILE *done = NULL;
+
       assert(argv[n] != NULL);
-      if (!process_file(argv[n], argv[n], processor, history_log_2, verbose,
-                        time, compress))
+      ++nfiles;
+      if (skip_ratio > 0 && features != NULL &&
+          features->is_incompressible(argv[n], &options, skip_ratio, time,
+                                      &done)) {
+        ++nskipped;
+        continue;
+      }
+      GKTRACE_BEGIN("process file");
+      if (!process_file(argv[n], argv[n], done, processor, &options, time,
+                        compress))
         rtn = EXIT_FAILURE;
+      GKTRACE_END("process file");
     }
+
+    if (skip_ratio > 0)
+      printf("Skipped %d of %d files as incompressible\n", nskipped, nfiles);
   } else {
     /* If an input file was specified, it should follow the switches */
     if (n < argc)
@@ -358,24 +691,26 @@ int main_common(int argc, const char *argv[], GKProcessFn *processor,
     if (n < argc) {
       if (output_file != NULL) {
         fputs("Cannot specify more than one output file\n", stderr);
-        return syntax_msg(stderr, argv[0]);
+        return syntax_msg(stderr, argv[0], tool);
       }
       output_file = argv[n++];
     }
 
-    if (output_file == NULL && (time || verbose)) {
+    if (output_file == NULL && (time || options.verbose)) {
       fputs("Must specify an output file in verbose/timer mode\n", stderr);
-      return syntax_msg(stderr, argv[0]);
+      return syntax_msg(stderr, argv[0], tool);
     }
 
     if (n < argc) {
       fputs("Too many arguments (did you intend -batch?)\n", stderr);
-      return syntax_msg(stderr, argv[0]);
+      return syntax_msg(stderr, argv[0], tool);
     }
 
-    if (!process_file(input_file, output_file, processor, history_log_2,
-                      verbose, time, compress))
+    GKTRACE_BEGIN("process file");
+    if (!process_file(input_file, output_file, NULL, processor, &options,
+                      time, compress))
       rtn = EXIT_FAILURE;
+    GKTRACE_END("process file");
   }
 
   return rtn;
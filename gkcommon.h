@@ -25,10 +25,68 @@
 #include <stdbool.h>
 #include <stdio.h>
 
-typedef bool GKProcessFn(FILE *in, FILE *out, unsigned int history_log_2,
-                         bool verbose);
+/* Local headers */
+#include "misc.h"
 
+typedef enum {
+  GKTool_Compress,
+  GKTool_Decompress,
+  GKTool_Recompress
+} GKTool;
+
+typedef struct {
+  unsigned int history_log_2;    /* Base 2 logarithm of the history size
+                                    (of the input, if recompressing) */
+  unsigned int to_history_log_2; /* Base 2 logarithm of the history size
+                                    of the output, if recompressing */
+  unsigned int level;            /* Compression level, or 0 to compress
+                                    using GKeyLib */
+  bool verbose;
+  bool stream;                   /* Write output with bounded latency,
+                                    if decompressing */
+  _Optional const char *checkpoints; /* Name of a file in which to save
+                                        checkpoints, if compressing at a
+                                        level */
+} GKOptions;
+
+typedef bool GKProcessFn(FILE *in, FILE *out, const GKOptions *options);
+
+/* Decide whether compressing a file would give a ratio over the given
+   percentage, so that it should be left untouched. If the file is to be
+   compressed and its compressed form was produced whilst deciding, then
+   that is output as a temporary file positioned at its start (otherwise
+   NULL). With 'time' or verbose, each file skipped is reported. */
+typedef bool GKSkipFn(const char *file_name, const GKOptions *options,
+                      long int skip_ratio, bool time, _Optional FILE **done);
+
+/* Choose the code path for the match search, no faster than the named one
+   (if any), and report the choice if verbose. Prints a message and returns
+   false on failure. */
+typedef bool GKSelectCpuFn(_Optional const char *cpu, bool verbose);
+
+/* Print a table of the estimated compressed size of a file at each history
+   size in the given range. Prints a message and returns false on failure. */
+typedef bool GKEstimateFn(const char *file_name, unsigned int min_log_2,
+                          unsigned int max_log_2, bool time);
+
+/* Keep processed copies of the files in one directory in another, as
+   described for gkwatch_run. */
+typedef bool GKWatchFn(const char *src_dir, const char *dst_dir,
+                       GKProcessFn *processor, const GKOptions *options,
+                       bool time);
+
+/* Features that only the compressor has, supplied by it so that the other
+   programs need not be linked with their implementations */
+typedef struct {
+  GKSkipFn *is_incompressible;
+  GKSelectCpuFn *select_cpu;
+  GKEstimateFn *estimate;
+  GKWatchFn *watch;
+} GKCompFeatures;
+
+/* 'features' must be NULL unless 'tool' is GKTool_Compress. */
 int main_common(int argc, const char *argv[], GKProcessFn *processor,
-                const char *description, bool compress);
+                const char *description, GKTool tool,
+                _Optional const GKCompFeatures *features);
 
 #endif /* GKCOMMON_H */
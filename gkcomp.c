@@ -25,6 +25,7 @@
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
+#include <time.h>
 
 /* CBUtilLib headers */
 #include "FileRWInt.h"
@@ -33,14 +34,25 @@
 #include "GKeyComp.h"
 
 /* Local headers */
+#include "filetype.h"
+#include "gkcheckpoint.h"
 #include "gkcommon.h"
+#include "gkcpu.h"
+#include "gkencoder.h"
+#include "gkestimate.h"
+#include "gkmatch.h"
+#include "gksample.h"
+#include "gktrace.h"
+#include "gkwatch.h"
 #include "misc.h"
 #include "version.h"
 
 /* Constant numeric values */
 enum {
   FEDNET_HEADER_SIZE = 4, /* No. of bytes in a 32 bit integer */
-  BUFFER_SIZE = 256,      /* I/O buffer size, in bytes */
+  BUFFER_SIZE = 65536,    /* I/O buffer size, in bytes. Large enough that
+                             the compressor seldom runs out of room for
+                             output part-way through a directive. */
   PROGRESS_FREQ = 64,     /* No. of bytes to read between progress reports */
 };
 
@@ -84,16 +96,28 @@ static long int flen(FILE *f)
   return len;
 }
 
-static bool comp(FILE *in, FILE *out, unsigned int history_log_2, bool verbose)
+static bool comp(FILE *in, FILE *out, const GKOptions *options)
 {
-  char in_buffer[BUFFER_SIZE], out_buffer[BUFFER_SIZE];
-  bool success = false;
+  _Optional char *in_buffer = NULL, *out_buffer = NULL;
+  bool success = false, verbose;
   long int in_total, out_total, in_told;
   _Optional GKeyComp *comp = NULL;
+  _Optional GKEncoder *enc = NULL;
   GKeyStatus status;
 
   assert(in != NULL);
   assert(out != NULL);
+  assert(options != NULL);
+  verbose = options->verbose;
+
+  if (options->checkpoints != NULL) {
+    if (verbose)
+      printf("Compressing at level %u with checkpoints\n", options->level);
+
+    return gkcheckpoint_compress(in, out, &*options->checkpoints,
+                                 options->history_log_2, options->level,
+                                 verbose);
+  }
 
   out_total = in_total = 0;
 
@@ -130,15 +154,25 @@ static bool comp(FILE *in, FILE *out, unsigned int history_log_2, bool verbose)
   /* We either wrote the uncompressed size or left room to do so */
   out_total += FEDNET_HEADER_SIZE;
 
-  comp = gkeycomp_make(history_log_2);
-  if (comp == NULL) {
+  /* The buffers are too big for the stack on some platforms */
+  in_buffer = malloc(BUFFER_SIZE);
+  out_buffer = malloc(BUFFER_SIZE);
+  if (options->level > 0) {
+    if (verbose)
+      printf("Compressing at level %u\n", options->level);
+    enc = gkencoder_make(options->history_log_2, options->level);
+  } else {
+    comp = gkeycomp_make(options->history_log_2);
+  }
+  if (in_buffer == NULL || out_buffer == NULL ||
+      (comp == NULL && enc == NULL)) {
     fprintf(stderr, "Failed to allocate memory: %s\n", strerror(errno));
     goto cleanup;
   }
 
   GKeyParameters params = {
-    .out_buffer = out_buffer,
-    .out_size = sizeof(out_buffer),
+    .out_buffer = &*out_buffer,
+    .out_size = BUFFER_SIZE,
     .in_size = 0,
     .prog_cb = verbose ? update_progress : (GKeyProgressFn *)NULL,
   };
@@ -149,9 +183,11 @@ static bool comp(FILE *in, FILE *out, unsigned int history_log_2, bool verbose)
        split sequence. */
     if (params.in_size == 0) {
       /* Fill the input buffer by reading from file */
-      params.in_buffer = in_buffer;
-      params.in_size = fread(in_buffer, 1, sizeof(in_buffer), in);
-      if (params.in_size != sizeof(in_buffer) && ferror(in)) {
+      params.in_buffer = &*in_buffer;
+      GKTRACE_BEGIN("read");
+      params.in_size = fread(&*in_buffer, 1, BUFFER_SIZE, in);
+      GKTRACE_END("read");
+      if (params.in_size != BUFFER_SIZE && ferror(in)) {
         /* Read error not end of file */
         fprintf(stderr, "Failed to read uncompressed data from input: %s\n",
                 strerror(errno));
@@ -165,23 +201,32 @@ static bool comp(FILE *in, FILE *out, unsigned int history_log_2, bool verbose)
     /* Compress the data from the input buffer to the output buffer.
        If the input buffer is empty then this flushes any pending output.
        Returns GKeyStatus_Finished when the flush is complete. */
-    status = gkeycomp_compress(&*comp, &params);
+    GKTRACE_BEGIN("compress");
+    if (enc != NULL)
+      status = gkencoder_compress(&*enc, &params);
+    else
+      status = gkeycomp_compress(&*comp, &params);
+    GKTRACE_END("compress");
 
     /* Is the output buffer full or have we finished? */
     if (status == GKeyStatus_Finished || status == GKeyStatus_BufferOverflow ||
         params.out_size == 0) {
       /* Empty the output buffer by writing to file */
-      const size_t nout = sizeof(out_buffer) - params.out_size;
+      const size_t nout = BUFFER_SIZE - params.out_size;
+      size_t nwritten;
       out_total += nout;
 
-      if (fwrite(out_buffer, 1, nout, out) != nout) {
+      GKTRACE_BEGIN("write");
+      nwritten = fwrite(&*out_buffer, 1, nout, out);
+      GKTRACE_END("write");
+      if (nwritten != nout) {
         fprintf(stderr, "Failed to write %lu bytes to output: %s\n",
                 (unsigned long)nout, strerror(errno));
         goto cleanup;
       }
 
-      params.out_buffer = out_buffer;
-      params.out_size = sizeof(out_buffer);
+      params.out_buffer = &*out_buffer;
+      params.out_size = BUFFER_SIZE;
 
       if (status == GKeyStatus_BufferOverflow)
         status = GKeyStatus_OK; /* Buffer overflow has been fixed up */
@@ -225,15 +270,157 @@ static bool comp(FILE *in, FILE *out, unsigned int history_log_2, bool verbose)
   success = true;
 
 cleanup:
+  gkencoder_destroy(enc);
   gkeycomp_destroy(comp);
+  free(out_buffer);
+  free(in_buffer);
+  return success;
+}
+
+static bool is_incompressible(const char *file_name, const GKOptions *options,
+                              long int skip_ratio, bool time,
+                              _Optional FILE **done)
+{
+  /* Estimate whether compressing a file would give a ratio over the given
+     percentage. A small file is compressed in full instead, which gives an
+     exact result and output that can be kept. If the estimate fails then
+     let compression report it. */
+  _Optional FILE *in, *out = NULL;
+  bool skip = false, success = false, sampled = false;
+  double ratio = 0.0;
+  long int len;
+  unsigned long long start_time;
+
+  assert(file_name != NULL);
+  assert(options != NULL);
+  assert(done != NULL);
+
+  *done = NULL;
+
+  in = fopen(file_name, "rb");
+  if (in == NULL)
+    return false;
+
+  start_time = time ? clock_us() : 0;
+
+  len = flen(&*in);
+  if (len > GKSAMPLE_TOTAL_SIZE) {
+    success = gksample_ratio(&*in, options->history_log_2, options->level,
+                             options->verbose, &ratio);
+    sampled = true;
+  } else if (len > 0) {
+    out = tmpfile();
+    if (out == NULL) {
+      fprintf(stderr, "Failed to create temporary output file: %s\n",
+              strerror(errno));
+    } else if (comp(&*in, &*out, options)) {
+      const long int out_len = flen(&*out);
+
+      if (out_len != -1L) {
+        ratio = (double)out_len * 100 / len;
+        success = true;
+      }
+    }
+  }
+
+  if (success && time) {
+    printf("Time taken%s: %.2f seconds\n", sampled ? " to sample" : "",
+           (double)(clock_us() - start_time) / 1000000);
+  }
+
+  /* Compressing an empty file is cheap, so never skip one */
+  if (success && ratio > skip_ratio) {
+    skip = true;
+    if (time || options->verbose)
+      printf("Skipped '%s' (estimated ratio %.2f%%)\n", file_name, ratio);
+  }
+
+  if (success && !skip && out != NULL) {
+    *done = out;
+  } else if (out != NULL) {
+    fclose(&*out);
+  }
+
+  fclose(&*in);
+  return skip;
+}
+
+static bool select_cpu(_Optional const char *cpu, bool verbose)
+{
+  if (!gkcpu_init(cpu))
+    return false;
+
+  /* Choose the match search in time for it to be reported */
+  gkmatch_select();
+
+  if (verbose)
+    gkcpu_report(stdout);
+
+  return true;
+}
+
+static bool estimate_file(const char *file_name, unsigned int min_log_2,
+                          unsigned int max_log_2, bool time)
+{
+  GKEstimate estimates[GKESTIMATE_MAX_LOG_2 + 1];
+  _Optional FILE *in;
+  bool success;
+  const clock_t start_time = time ? clock() : 0;
+
+  assert(file_name != NULL);
+  assert(min_log_2 <= max_log_2);
+  assert(max_log_2 <= GKESTIMATE_MAX_LOG_2);
+
+  in = fopen(file_name, "rb");
+  if (in == NULL) {
+    fprintf(stderr, "Failed to open input file: %s\n", strerror(errno));
+    return false;
+  }
+
+  GKTRACE_BEGIN("estimate");
+  success = gkestimate_file(&*in, min_log_2, max_log_2, estimates);
+  GKTRACE_END("estimate");
+  fclose(&*in);
+
+  if (success) {
+    unsigned int h;
+
+    printf("Estimated compression of '%s' (%ld bytes, %ld sampled)\n\n"
+           "History | Copied (%%) | Literals (%%) | Ratio (%%) | "
+           "95%% interval (%%) |  Size (bytes)\n"
+           "--------|------------|--------------|-----------|"
+           "------------------|--------------\n",
+           file_name, estimates[0].size, estimates[0].sampled);
+
+    for (h = min_log_2; h <= max_log_2; ++h) {
+      const GKEstimate *const e = &estimates[h - min_log_2];
+
+      printf("%7u | %10.2f | %12.2f | %9.2f | %7.2f - %7.2f | %13ld\n", h,
+             e->copied, e->sampled > 0 ? 100.0 - e->copied : 0.0, e->ratio,
+             e->ratio_low, e->ratio_high, e->out_size);
+    }
+
+    if (time) {
+      printf("Time taken: %.2f seconds\n",
+             (double)(clock_t)(clock() - start_time) / CLOCKS_PER_SEC);
+    }
+  }
+
   return success;
 }
 
 int main(int argc, const char *argv[])
 {
+  static const GKCompFeatures features = {
+    .is_incompressible = is_incompressible,
+    .select_cpu = select_cpu,
+    .estimate = estimate_file,
+    .watch = gkwatch_run,
+  };
   static const char description[] =
     "Gordon Key file compression utility, " VERSION_STRING "\n"
     "Copyright (C) 2011, Christopher Bazley";
 
-  return main_common(argc, argv, comp, description, true);
+  return main_common(argc, argv, comp, description, GKTool_Compress,
+                     &features);
 }
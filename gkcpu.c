@@ -0,0 +1,213 @@
+/*
+ *  Gordon Key file compression utilities
+ *  Runtime selection of code paths for the CPU
+ *  Copyright (C) 2026 Christopher Bazley
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public Licence as published by
+ *  the Free Software Foundation; either version 2 of the Licence, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public Licence for more details.
+ *
+ *  You should have received a copy of the GNU General Public Licence
+ *  along with this program; if not, write to the Free Software
+ *  Foundation, Inc., 675 Mass Ave, Cambridge, MA 02139, USA.
+ */
+
+/* ISO library header files */
+#include <assert.h>
+#include <stdbool.h>
+#include <stdio.h>
+#include <string.h>
+
+#if defined(_MSC_VER) && (defined(_M_X64) || defined(_M_IX86))
+#include <immintrin.h> /* Required for _xgetbv */
+#include <intrin.h>    /* Required for __cpuid and __cpuidex */
+#endif
+
+/* Local headers */
+#include "gkcpu.h"
+#include "misc.h"
+
+enum {
+  MAX_KERNELS = 8 /* No. of kernels whose choice of path is remembered */
+};
+
+typedef struct {
+  const char *name;
+  GKCpuPath path;
+} Kernel;
+
+static const char *const names[GKCpu_Count] = {
+  [GKCpu_Scalar] = "scalar",
+  [GKCpu_NEON] = "neon",
+  [GKCpu_SSE2] = "sse2",
+  [GKCpu_AVX2] = "avx2",
+};
+
+static bool initialised;
+static bool supported[GKCpu_Count];
+static GKCpuPath limit_path;
+static Kernel kernels[MAX_KERNELS];
+static size_t nkernels;
+
+static void detect(void)
+{
+  /* Baseline instruction sets of the target need no runtime check */
+  supported[GKCpu_Scalar] = true;
+
+#ifdef __ARM_NEON
+  supported[GKCpu_NEON] = true;
+#endif
+
+#if defined(__SSE2__) || defined(_M_X64) ||                                    \
+  (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+  supported[GKCpu_SSE2] = true;
+#endif
+
+#if (defined(__GNUC__) || defined(__clang__)) &&                               \
+  (defined(__x86_64__) || defined(__i386__))
+  /* Uses CPUID, and also checks that the OS saves the AVX registers */
+  __builtin_cpu_init();
+  if (__builtin_cpu_supports("sse2"))
+    supported[GKCpu_SSE2] = true;
+  if (__builtin_cpu_supports("avx2"))
+    supported[GKCpu_AVX2] = true;
+#elif defined(_MSC_VER) && (defined(_M_X64) || defined(_M_IX86))
+  {
+    int info[4];
+
+    __cpuid(info, 0);
+    if (info[0] >= 1) {
+      const int max_leaf = info[0];
+
+      __cpuid(info, 1);
+      if (info[3] & (1 << 26))
+        supported[GKCpu_SSE2] = true;
+
+      /* AVX2 needs the OS to save the YMM registers (OSXSAVE and XCR0) */
+      if (max_leaf >= 7 && (info[2] & (1 << 27)) && (info[2] & (1 << 28)) &&
+          (_xgetbv(0) & 6) == 6) {
+        __cpuidex(info, 7, 0);
+        if (info[1] & (1 << 5))
+          supported[GKCpu_AVX2] = true;
+      }
+    }
+  }
+#endif
+}
+
+bool gkcpu_init(_Optional const char *limit)
+{
+  GKCpuPath path;
+
+  if (!initialised) {
+    detect();
+    initialised = true;
+  }
+
+  /* Use the best supported path unless told otherwise */
+  for (path = GKCpu_Scalar; path < GKCpu_Count; ++path) {
+    if (supported[path])
+      limit_path = path;
+  }
+
+  if (limit != NULL) {
+    for (path = GKCpu_Scalar; path < GKCpu_Count; ++path) {
+      if (!strcmp(&*limit, names[path]))
+        break;
+    }
+
+    if (path == GKCpu_Count) {
+      fprintf(stderr, "Unrecognised CPU code path '%s' (expected", &*limit);
+      for (path = GKCpu_Scalar; path < GKCpu_Count; ++path)
+        fprintf(stderr, " %s", names[path]);
+      fputs(")\n", stderr);
+      return false;
+    }
+
+    if (!supported[path]) {
+      fprintf(stderr, "This CPU does not support the %s code path\n",
+              names[path]);
+      return false;
+    }
+
+    limit_path = path;
+  }
+
+  return true;
+}
+
+bool gkcpu_supported(GKCpuPath path)
+{
+  assert(path >= GKCpu_Scalar);
+  assert(path < GKCpu_Count);
+
+  if (!initialised)
+    (void)gkcpu_init(NULL);
+
+  return supported[path];
+}
+
+const char *gkcpu_name(GKCpuPath path)
+{
+  assert(path >= GKCpu_Scalar);
+  assert(path < GKCpu_Count);
+  return names[path];
+}
+
+GKCpuPath gkcpu_select(const char *kernel, unsigned int compiled)
+{
+  GKCpuPath path, best = GKCpu_Scalar;
+  size_t k;
+
+  assert(kernel != NULL);
+  assert(compiled & (1u << GKCpu_Scalar));
+
+  if (!initialised)
+    (void)gkcpu_init(NULL);
+
+  for (path = GKCpu_Scalar; path <= limit_path; ++path) {
+    if (supported[path] && (compiled & (1u << path)))
+      best = path;
+  }
+
+  /* Remember the choice, replacing any earlier choice for the kernel */
+  for (k = 0; k < nkernels && strcmp(kernels[k].name, kernel); ++k)
+    ;
+
+  if (k < MAX_KERNELS) {
+    kernels[k].name = kernel;
+    kernels[k].path = best;
+    if (k == nkernels)
+      ++nkernels;
+  }
+
+  return best;
+}
+
+void gkcpu_report(FILE *f)
+{
+  GKCpuPath path;
+  size_t k;
+
+  assert(f != NULL);
+
+  if (!initialised)
+    (void)gkcpu_init(NULL);
+
+  fputs("CPU supports code paths:", f);
+  for (path = GKCpu_Scalar; path < GKCpu_Count; ++path) {
+    if (supported[path])
+      fprintf(f, " %s", names[path]);
+  }
+  fprintf(f, " (using up to %s)\n", names[limit_path]);
+
+  for (k = 0; k < nkernels; ++k)
+    fprintf(f, "Using %s code path for %s\n", names[kernels[k].path],
+            kernels[k].name);
+}
@@ -0,0 +1,50 @@
+/*
+ *  Gordon Key file compression utilities
+ *  Runtime selection of code paths for the CPU
+ *  Copyright (C) 2026 Christopher Bazley
+ */
+
+#ifndef GKCPU_H
+#define GKCPU_H
+
+/* ISO library header files */
+#include <stdbool.h>
+#include <stdio.h>
+
+/* Local headers */
+#include "misc.h"
+
+/* Code paths in order of preference. A kernel need not provide all of
+   them; 'GKCpu_Scalar' must always be provided. */
+typedef enum {
+  GKCpu_Scalar,
+  GKCpu_NEON,
+  GKCpu_SSE2,
+  GKCpu_AVX2,
+  GKCpu_Count
+} GKCpuPath;
+
+/* Find out which code paths the CPU supports. If a path name is given (as
+   by a '-cpu' switch) then kernels will not use any better path than that.
+   Prints a message and returns false if the name is not recognised or the
+   CPU does not support it. This is done automatically (with no limit) if
+   not already done when a kernel is selected, and may be repeated before
+   reselecting kernels. */
+bool gkcpu_init(_Optional const char *limit);
+
+/* Find out whether the CPU supports a code path. */
+bool gkcpu_supported(GKCpuPath path);
+
+/* Get the name of a code path, as accepted by gkcpu_init. */
+const char *gkcpu_name(GKCpuPath path);
+
+/* Choose the best code path for a kernel, given a bit mask of the paths
+   that were compiled (with bit n set for path n), and remember the choice
+   for gkcpu_report. Kernels should select a path once, before starting any
+   threads that use them. */
+GKCpuPath gkcpu_select(const char *kernel, unsigned int compiled);
+
+/* Print the code paths supported by the CPU and any chosen for kernels. */
+void gkcpu_report(FILE *f);
+
+#endif /* GKCPU_H */
@@ -0,0 +1,190 @@
+/*
+ *  Gordon Key file compression utilities
+ *  Incremental decompression of a compressed file
+ *  Copyright (C) 2026 Christopher Bazley
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public Licence as published by
+ *  the Free Software Foundation; either version 2 of the Licence, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public Licence for more details.
+ *
+ *  You should have received a copy of the GNU General Public Licence
+ *  along with this program; if not, write to the Free Software
+ *  Foundation, Inc., 675 Mass Ave, Cambridge, MA 02139, USA.
+ */
+
+/* ISO library header files */
+#include <assert.h>
+#include <errno.h>
+#include <stdbool.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+/* CBUtilLib headers */
+#include "FileRWInt.h"
+
+/* GKeyLib headers */
+#include "GKeyDecomp.h"
+
+/* Local headers */
+#include "gkdecoder.h"
+#include "gktrace.h"
+#include "misc.h"
+
+enum {
+  BUFFER_SIZE = 65536 /* Input buffer size, in bytes */
+};
+
+struct GKDecoder {
+  FILE *in;
+  _Optional GKeyDecomp *decomp;
+  GKeyParameters params;
+  GKeyStatus status;
+  long int in_total, out_total;
+  bool finished;
+  char in_buffer[BUFFER_SIZE];
+};
+
+bool gkdecoder_read_size(FILE *in, long int *expected)
+{
+  assert(in != NULL);
+  assert(expected != NULL);
+
+  if (!fread_int32le(expected, in)) {
+    fprintf(stderr, "Failed to read uncompressed size: %s\n", strerror(errno));
+    return false;
+  }
+
+  if (*expected < 0) {
+    /* Gordon Key's file decompression module 'FDComp', which is presumably
+       normative, rejects top bit set values. */
+    fprintf(stderr, "Negative or over-large uncompressed size %ld\n",
+            *expected);
+    return false;
+  }
+
+  return true;
+}
+
+_Optional GKDecoder *gkdecoder_make(FILE *in, unsigned int history_log_2)
+{
+  _Optional GKDecoder *const dec = calloc(1, sizeof(*dec));
+
+  assert(in != NULL);
+
+  if (dec != NULL) {
+    dec->in = in;
+    dec->decomp = gkeydecomp_make(history_log_2);
+    if (dec->decomp == NULL) {
+      free(dec);
+      return NULL;
+    }
+  }
+  return dec;
+}
+
+void gkdecoder_destroy(_Optional GKDecoder *dec)
+{
+  if (dec != NULL) {
+    gkeydecomp_destroy(dec->decomp);
+    free(dec);
+  }
+}
+
+bool gkdecoder_read(GKDecoder *dec, char *out_buffer, size_t out_size,
+                    size_t *nout)
+{
+  bool in_pending;
+  size_t n;
+
+  assert(dec != NULL);
+  assert(!dec->finished);
+  assert(dec->decomp != NULL);
+  assert(out_buffer != NULL);
+  assert(nout != NULL);
+
+  /* Nothing is output on failure */
+  *nout = 0;
+
+  dec->params.out_buffer = out_buffer;
+  dec->params.out_size = out_size;
+
+  do {
+    /* Is the input buffer empty? */
+    if (dec->params.in_size == 0) {
+      /* Fill the input buffer by reading from file */
+      dec->params.in_buffer = dec->in_buffer;
+      GKTRACE_BEGIN("read");
+      dec->params.in_size =
+        fread(dec->in_buffer, 1, sizeof(dec->in_buffer), dec->in);
+      GKTRACE_END("read");
+      if (dec->params.in_size != sizeof(dec->in_buffer) && ferror(dec->in)) {
+        /* Read error not end of file */
+        fprintf(stderr, "Failed to read compressed data from file: %s\n",
+                strerror(errno));
+        return false;
+      }
+      dec->in_total += dec->params.in_size;
+    }
+
+    /* Decompress the data from the input buffer to the output buffer */
+    GKTRACE_BEGIN("decompress");
+    dec->status = gkeydecomp_decompress(&*dec->decomp, &dec->params);
+    GKTRACE_END("decompress");
+
+    /* If the input buffer is empty and it cannot be (re-)filled then
+       there is no more input pending. */
+    in_pending = dec->params.in_size > 0 || !feof(dec->in);
+
+    if (in_pending && dec->status == GKeyStatus_TruncatedInput) {
+      /* False alarm before end of input data */
+      dec->status = GKeyStatus_OK;
+    }
+
+    if (dec->status == GKeyStatus_BadInput) {
+      fprintf(stderr, "Compressed bitstream contains bad data\n");
+      return false;
+    }
+
+    /* Stop when the output buffer is full or there is no more input. */
+  } while (dec->status != GKeyStatus_BufferOverflow &&
+           dec->params.out_size > 0 && in_pending);
+
+  n = out_size - dec->params.out_size;
+  dec->out_total += (long int)n;
+
+  if (dec->status != GKeyStatus_BufferOverflow && !in_pending) {
+    dec->finished = true;
+    if (dec->status == GKeyStatus_TruncatedInput) {
+      fprintf(stderr, "Compressed bitstream appears truncated\n");
+      return false;
+    }
+  }
+
+  *nout = n;
+  return true;
+}
+
+bool gkdecoder_finished(const GKDecoder *dec)
+{
+  assert(dec != NULL);
+  return dec->finished;
+}
+
+long int gkdecoder_in_total(const GKDecoder *dec)
+{
+  assert(dec != NULL);
+  return dec->in_total;
+}
+
+long int gkdecoder_out_total(const GKDecoder *dec)
+{
+  assert(dec != NULL);
+  return dec->out_total;
+}
@@ -0,0 +1,44 @@
+/*
+ *  Gordon Key file compression utilities
+ *  Incremental decompression of a compressed file
+ *  Copyright (C) 2026 Christopher Bazley
+ */
+
+#ifndef GKDECODER_H
+#define GKDECODER_H
+
+/* ISO library header files */
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdio.h>
+
+/* Local headers */
+#include "misc.h"
+
+typedef struct GKDecoder GKDecoder;
+
+/* Read the expected size of the decompressed data from the start of a
+   compressed file. Prints a message and returns false on failure. */
+bool gkdecoder_read_size(FILE *in, long int *expected);
+
+/* Create a decoder for the compressed data that follows the header. */
+_Optional GKDecoder *gkdecoder_make(FILE *in, unsigned int history_log_2);
+
+void gkdecoder_destroy(_Optional GKDecoder *dec);
+
+/* Decompress data into the given buffer until it is full or the input is
+   exhausted, and output the number of bytes decompressed. Prints a message,
+   outputs 0 and returns false on failure. */
+bool gkdecoder_read(GKDecoder *dec, char *out_buffer, size_t out_size,
+                    size_t *nout);
+
+/* Find out whether all of the input has been decompressed. */
+bool gkdecoder_finished(const GKDecoder *dec);
+
+/* Get the number of bytes of compressed data read so far. */
+long int gkdecoder_in_total(const GKDecoder *dec);
+
+/* Get the number of bytes of data decompressed so far. */
+long int gkdecoder_out_total(const GKDecoder *dec);
+
+#endif /* GKDECODER_H */
@@ -33,7 +33,9 @@
 #include "GKeyDecomp.h"
 
 /* Local headers */
+#include "filetype.h"
 #include "gkcommon.h"
+#include "gktrace.h"
 #include "misc.h"
 #include "version.h"
 
@@ -42,10 +44,25 @@ enum {
   FEDNET_HEADER_SIZE = 4, /* No. of bytes in a 32 bit integer */
   BUFFER_SIZE = 256,      /* I/O buffer size, in bytes */
   PROGRESS_FREQ = 64,     /* No. of bytes to read between progress reports */
-  FEDNET_COMP_LOG_2 = 9   /* Base 2 logarithm of the history size used by
+  FEDNET_COMP_LOG_2 = 9,  /* Base 2 logarithm of the history size used by
                              the compression algorithm, in bytes */
+  MIN_HOLE_SIZE = 4096,   /* Minimum no. of zero bytes to seek over instead
+                             of writing (typical file system block size) */
+  STREAM_SIZE = 4096,     /* Output buffer size in streaming mode, which
+                             has no stdio buffer to reduce the no. of
+                             writes */
+  STREAM_DELAY = 50       /* Maximum time to hold decompressed data in
+                             streaming mode, in milliseconds */
 };
 
+typedef struct {
+  FILE *f;
+  bool sparse;        /* Seek over long runs of zeros instead of writing */
+  long int zeros;     /* No. of zero bytes not yet written */
+  long int hole_size; /* Total no. of zero bytes seeked over */
+  long int start;     /* File position of the first byte of output */
+} Output;
+
 static void show_progress(long int in, long int out)
 {
   if (out > 0) {
@@ -65,17 +82,143 @@ static bool update_progress(void *arg, size_t in, size_t out)
   return true; /* continue decompressing */
 }
 
-static bool decomp(FILE *in, FILE *out, unsigned int history_log_2,
-                   bool verbose)
+static bool write_zeros(Output *out)
+{
+  /* Write or seek over any zero bytes that are pending */
+  static const char zeros[BUFFER_SIZE];
+
+  if (out->sparse && out->zeros >= MIN_HOLE_SIZE) {
+    if (fseek(out->f, out->zeros, SEEK_CUR)) {
+      fprintf(stderr, "Failed to seek in output file\n");
+      return false;
+    }
+    out->hole_size += out->zeros;
+    out->zeros = 0;
+  }
+
+  while (out->zeros > 0) {
+    const size_t n =
+      out->zeros > (long int)sizeof(zeros) ? sizeof(zeros) : (size_t)out->zeros;
+
+    if (fwrite(zeros, 1, n, out->f) != n) {
+      fprintf(stderr, "Failed to write %lu bytes to file: %s\n",
+              (unsigned long)n, strerror(errno));
+      return false;
+    }
+    out->zeros -= (long int)n;
+  }
+
+  return true;
+}
+
+static bool write_output(Output *out, const char *data, size_t n)
+{
+  /* Write decompressed data, deferring runs of zeros in case they are
+     long enough to leave a hole in the output file */
+  size_t start = 0;
+
+  if (!out->sparse) {
+    if (fwrite(data, 1, n, out->f) != n) {
+      fprintf(stderr, "Failed to write %lu bytes to file: %s\n",
+              (unsigned long)n, strerror(errno));
+      return false;
+    }
+    return true;
+  }
+
+  while (start < n) {
+    size_t end = start;
+
+    while (end < n && data[end] == 0)
+      ++end;
+
+    out->zeros += (long int)(end - start);
+    start = end;
+
+    while (end < n && data[end] != 0)
+      ++end;
+
+    if (end > start) {
+      if (!write_zeros(out))
+        return false;
+
+      if (fwrite(data + start, 1, end - start, out->f) != end - start) {
+        fprintf(stderr, "Failed to write %lu bytes to file: %s\n",
+                (unsigned long)(end - start), strerror(errno));
+        return false;
+      }
+      start = end;
+    }
+  }
+
+  return true;
+}
+
+static bool finish_output(Output *out, long int expected)
 {
-  char in_buffer[BUFFER_SIZE], out_buffer[BUFFER_SIZE];
-  bool in_pending, success = false;
+  /* A hole at the end of the output only exists once the file size has
+     been set to include it. Use the length given by the header. */
+  const bool trailing_hole = out->sparse && out->zeros >= MIN_HOLE_SIZE;
+
+  if (!write_zeros(out))
+    return false;
+
+  if (trailing_hole) {
+    if (!set_file_size(out->f, out->start + expected)) {
+      fprintf(stderr, "Failed to set size of output file: %s\n",
+              strerror(errno));
+      return false;
+    }
+  }
+
+  return true;
+}
+
+static bool decomp(FILE *in, FILE *out, const GKOptions *options)
+{
+  char in_buffer[BUFFER_SIZE], out_buffer[STREAM_SIZE];
+  bool in_pending, success = false, verbose, stream, in_may_block = false,
+       pending = false, written = false;
   long int expected, out_total, in_total;
+  size_t out_capacity = BUFFER_SIZE;
+  unsigned long long start_time = 0, first_time = 0, pending_time = 0;
   _Optional GKeyDecomp *decomp = NULL;
   GKeyStatus status;
+  Output output = {.f = out};
 
   assert(in != NULL);
   assert(out != NULL);
+  assert(options != NULL);
+  verbose = options->verbose;
+  stream = options->stream;
+
+  if (verbose)
+    start_time = clock_us() / 1000;
+
+  if (stream) {
+    /* Write straight through to the file instead of waiting for a stdio
+       buffer to fill */
+    if (setvbuf(out, NULL, _IONBF, 0)) {
+      fprintf(stderr, "Failed to disable output buffering\n");
+      goto cleanup;
+    }
+    out_capacity = STREAM_SIZE;
+
+    /* Reading from a pipe or terminal may wait indefinitely for input,
+       unlike reading from a file */
+    in_may_block = ftell(in) < 0;
+  }
+
+  /* Seeking is only safe if it leaves a hole in a file. Output to a pipe
+     or terminal is written unchanged. Runs of zeros are not held back when
+     streaming. */
+  output.sparse = !stream && can_make_holes(out);
+  if (output.sparse) {
+    output.start = ftell(out);
+    output.sparse = output.start >= 0;
+  }
+  if (verbose && output.sparse)
+    puts("Output may contain holes instead of runs of zeros");
 
   out_total = in_total = 0;
 
@@ -94,7 +237,7 @@ static bool decomp(FILE *in, FILE *out, unsigned int history_log_2,
     goto cleanup;
   }
 
-  decomp = gkeydecomp_make(history_log_2);
+  decomp = gkeydecomp_make(options->history_log_2);
   if (decomp == NULL) {
     fprintf(stderr, "Failed to allocate memory: %s\n", strerror(errno));
     goto cleanup;
@@ -102,7 +245,7 @@ static bool decomp(FILE *in, FILE *out, unsigned int history_log_2,
 
   GKeyParameters params = {
     .out_buffer = out_buffer,
-    .out_size = sizeof(out_buffer),
+    .out_size = out_capacity,
     .in_size = 0,
     .prog_cb = verbose ? update_progress : (GKeyProgressFn *)NULL,
   };
@@ -112,7 +255,9 @@ static bool decomp(FILE *in, FILE *out, unsigned int history_log_2,
     if (params.in_size == 0) {
       /* Fill the input buffer by reading from file */
       params.in_buffer = in_buffer;
+      GKTRACE_BEGIN("read");
       params.in_size = fread(in_buffer, 1, sizeof(in_buffer), in);
+      GKTRACE_END("read");
       if (params.in_size != sizeof(in_buffer) && ferror(in)) {
         /* Read error not end of file */
         fprintf(stderr, "Failed to read compressed data from file: %s\n",
@@ -123,7 +268,9 @@ static bool decomp(FILE *in, FILE *out, unsigned int history_log_2,
     }
 
     /* Decompress the data from the input buffer to the output buffer */
+    GKTRACE_BEGIN("decompress");
     status = gkeydecomp_decompress(&*decomp, &params);
+    GKTRACE_END("decompress");
 
     /* If the input buffer is empty and it cannot be (re-)filled then
        there is no more input pending. */
@@ -135,27 +282,61 @@ static bool decomp(FILE *in, FILE *out, unsigned int history_log_2,
     }
 
     /* Is there insufficient room in the output buffer or no more input? */
-    if (status == GKeyStatus_BufferOverflow || !in_pending) {
-      const size_t nout = sizeof(out_buffer) - params.out_size;
+    bool flush = status == GKeyStatus_BufferOverflow || !in_pending;
+
+    if (stream && !flush && params.out_size < out_capacity) {
+      /* Don't hold decompressed data for longer than the time limit,
+         nor while waiting for input that may not come */
+      const unsigned long long now = clock_us() / 1000;
+
+      if (!pending) {
+        pending = true;
+        pending_time = now;
+      }
+
+      flush = now - pending_time >= STREAM_DELAY ||
+              (in_may_block && params.in_size == 0);
+    }
+
+    if (flush) {
+      const size_t nout = out_capacity - params.out_size;
+      bool written_ok;
+
       out_total += nout;
+      pending = false;
 
       /* Empty the output buffer by writing to file */
-      if (fwrite(out_buffer, 1, nout, out) != nout) {
-        fprintf(stderr, "Failed to write %lu bytes to file: %s\n",
-                (unsigned long)nout, strerror(errno));
+      GKTRACE_BEGIN("write");
+      written_ok = write_output(&output, out_buffer, nout);
+      GKTRACE_END("write");
+      if (!written_ok)
         goto cleanup;
+
+      if (!written && nout > 0) {
+        written = true;
+        if (verbose)
+          first_time = clock_us() / 1000;
       }
 
       params.out_buffer = out_buffer;
-      params.out_size = sizeof(out_buffer);
+      params.out_size = out_capacity;
     }
 
     /* Continue decompressing data until the output buffer wasn't filled
        and there is no more input available. */
   } while (status == GKeyStatus_BufferOverflow || in_pending);
 
-  if (verbose)
+  if (!finish_output(&output, expected))
+    goto cleanup;
+
+  if (verbose) {
     show_progress(in_total, out_total);
+    if (output.hole_size > 0)
+      printf("Left holes instead of writing %ld bytes of zeros\n",
+             output.hole_size);
+    if (written)
+      printf("Time to first byte: %llu ms\n", first_time - start_time);
+  }
 
   switch (status) {
     case GKeyStatus_BadInput:
@@ -187,5 +368,6 @@ int main(int argc, const char *argv[])
     "Gordon Key file decompression utility, " VERSION_STRING "\n"
     "Copyright (C) 2011, Christopher Bazley";
 
-  return main_common(argc, argv, decomp, description, false);
+  return main_common(argc, argv, decomp, description, GKTool_Decompress,
+                     NULL);
 }
@@ -0,0 +1,335 @@
+/*
+ *  Gordon Key file compression utilities
+ *  Compression with a choice of effort
+ *  Copyright (C) 2026 Christopher Bazley
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public Licence as published by
+ *  the Free Software Foundation; either version 2 of the Licence, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public Licence for more details.
+ *
+ *  You should have received a copy of the GNU General Public Licence
+ *  along with this program; if not, write to the Free Software
+ *  Foundation, Inc., 675 Mass Ave, Cambridge, MA 02139, USA.
+ */
+
+/* ISO library header files */
+#include <assert.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+
+/* GKeyLib headers */
+#include "GKeyComp.h"
+
+/* Local headers */
+#include "gkencoder.h"
+#include "gkmatch.h"
+#include "gkparse.h"
+#include "misc.h"
+
+enum {
+  BLOCK_SIZE = 65536, /* Minimum no. of bytes of input buffered at once */
+  WORD_BITS = 32,     /* No. of bits written to the output at once */
+  MAX_PUT_BITS = 1 + GKENCODER_MAX_LOG_2, /* Widest field written at once */
+  STAGE_SIZE = (GKPARSE_BATCH_SIZE * (1 + 2 * GKENCODER_MAX_LOG_2) + 7) / 8 +
+               (2 * WORD_BITS / 8) /* Output buffer size, enough for one
+                                      batch of directives and the flush */
+};
+
+struct GKEncoder {
+  unsigned int history_log_2;
+  unsigned int level;
+  size_t lookahead; /* No. of bytes of input needed beyond a position to
+                       parse it as if all of the input were present */
+  size_t size;      /* No. of bytes allocated for 'buffer' */
+  size_t pos;       /* Index in 'buffer' of the next byte to be parsed */
+  size_t end;       /* Index in 'buffer' of the end of the input */
+  size_t in_total;  /* No. of bytes of input parsed so far */
+  size_t out_total; /* No. of bytes of output produced so far */
+  uint64_t acc;     /* Bits not yet written to 'staged', LSB first */
+  unsigned int nbits; /* No. of bits in 'acc' */
+  size_t nstaged;   /* No. of bytes in 'staged' */
+  size_t sent;      /* No. of bytes copied from 'staged' to the caller */
+  bool flushed;     /* Have the bits left in 'acc' been staged? */
+  unsigned char *buffer; /* History followed by input not yet parsed */
+  unsigned char staged[STAGE_SIZE];
+};
+
+static void put_bits(GKEncoder *enc, uint32_t value, unsigned int n)
+{
+  /* Add a field to the accumulator, and write a whole word to the output
+     whenever there is one. Fewer than WORD_BITS bits are held between calls,
+     so the accumulator cannot overflow. */
+  assert(enc != NULL);
+  assert(n <= MAX_PUT_BITS);
+  assert(enc->nbits < WORD_BITS);
+  assert((value >> n) == 0);
+
+  enc->acc |= (uint64_t)value << enc->nbits;
+  enc->nbits += n;
+
+  if (enc->nbits >= WORD_BITS) {
+    unsigned char *const out = enc->staged + enc->nstaged;
+
+    assert(enc->nstaged + WORD_BITS / 8 <= sizeof(enc->staged));
+    out[0] = (unsigned char)enc->acc;
+    out[1] = (unsigned char)(enc->acc >> 8);
+    out[2] = (unsigned char)(enc->acc >> 16);
+    out[3] = (unsigned char)(enc->acc >> 24);
+    enc->nstaged += WORD_BITS / 8;
+    enc->out_total += WORD_BITS / 8;
+    enc->acc >>= WORD_BITS;
+    enc->nbits -= WORD_BITS;
+  }
+}
+
+static void put_tokens(GKEncoder *enc, const unsigned char *data,
+                       const GKMatch *tokens, size_t ntokens)
+{
+  /* Pack a batch of directives. The type bit comes first, then a literal
+     byte or the offset and length of a copy. The offset is relative to a
+     point one history size behind the current position, and the length has
+     one bit fewer if the offset is in the more recent half of the history. */
+  const unsigned int h = enc->history_log_2;
+  const uint32_t window = (uint32_t)1 << h;
+  size_t i;
+
+  assert(data != NULL);
+  assert(tokens != NULL || ntokens == 0);
+
+  for (i = 0; i < ntokens; ++i) {
+    if (tokens[i].length == 0) {
+      put_bits(enc, (uint32_t)*data << 1, GKMATCH_LITERAL_BITS);
+      ++data;
+    } else {
+      const uint32_t offset = window - tokens[i].distance;
+
+      assert(tokens[i].distance >= 1);
+      assert(tokens[i].distance <= window);
+      assert(tokens[i].length <=
+             gkmatch_max_length(tokens[i].distance, h));
+
+      put_bits(enc, 1 | (offset << 1), 1 + h);
+      put_bits(enc, tokens[i].length, offset >= window / 2 ? h - 1 : h);
+      data += tokens[i].length;
+    }
+  }
+}
+
+static bool send_staged(GKEncoder *enc, GKeyParameters *params)
+{
+  /* Copy as much of the staged output as possible to the caller's buffer,
+     and return true if all of it was copied */
+  size_t n = enc->nstaged - enc->sent;
+
+  assert(params != NULL);
+
+  if (n > params->out_size)
+    n = params->out_size;
+
+  if (n > 0) {
+    memcpy(params->out_buffer, enc->staged + enc->sent, n);
+    params->out_buffer = (char *)params->out_buffer + n;
+    params->out_size -= n;
+    enc->sent += n;
+  }
+
+  if (enc->sent < enc->nstaged)
+    return false;
+
+  enc->nstaged = enc->sent = 0;
+  return true;
+}
+
+static void fill_buffer(GKEncoder *enc, GKeyParameters *params)
+{
+  /* Copy as much input as will fit after the data not yet parsed */
+  size_t n = enc->size - enc->end;
+
+  assert(params != NULL);
+
+  if (n > params->in_size)
+    n = params->in_size;
+
+  if (n > 0) {
+    memcpy(enc->buffer + enc->end, params->in_buffer, n);
+    params->in_buffer = (const char *)params->in_buffer + n;
+    params->in_size -= n;
+    enc->end += n;
+  }
+}
+
+static void slide_buffer(GKEncoder *enc)
+{
+  /* Discard input that is no longer within the history buffer, to make
+     room for more */
+  const size_t window = (size_t)1 << enc->history_log_2;
+  const size_t discard = enc->pos - window;
+
+  assert(enc->pos >= window);
+
+  memmove(enc->buffer, enc->buffer + discard, enc->end - discard);
+  enc->pos -= discard;
+  enc->end -= discard;
+}
+
+static bool put_batch(GKEncoder *enc, bool final)
+{
+  /* Choose directives for the next part of the input and stage their output.
+     Unless this is the final part of the input, stop short of the end of the
+     data buffered so far, in case a match continues beyond it. Returns false
+     if there was not enough data. */
+  GKMatch tokens[GKPARSE_BATCH_SIZE];
+  size_t limit, ntokens, consumed;
+
+  if (final) {
+    limit = enc->end;
+  } else if (enc->end - enc->pos > enc->lookahead) {
+    limit = enc->end - enc->lookahead;
+  } else {
+    return false;
+  }
+
+  if (limit <= enc->pos)
+    return false;
+
+  ntokens = gkparse_tokens(enc->buffer + enc->pos, enc->end - enc->pos,
+                           limit - enc->pos, enc->history_log_2, enc->level,
+                           tokens, GKPARSE_BATCH_SIZE, &consumed);
+
+  put_tokens(enc, enc->buffer + enc->pos, tokens, ntokens);
+  enc->pos += consumed;
+  enc->in_total += consumed;
+  return true;
+}
+
+_Optional GKEncoder *gkencoder_make(unsigned int history_log_2,
+                                    unsigned int level)
+{
+  _Optional GKEncoder *enc = NULL;
+  const size_t window = (size_t)1 << history_log_2;
+
+  assert(history_log_2 <= GKENCODER_MAX_LOG_2);
+  assert(level >= GKPARSE_MIN_LEVEL);
+  assert(level <= GKPARSE_MAX_LEVEL);
+
+  enc = malloc(sizeof(*enc));
+  if (enc != NULL) {
+    enc->history_log_2 = history_log_2;
+    enc->level = level;
+    enc->lookahead = window + GKPARSE_MAX_LAZY;
+    enc->size = window + enc->lookahead + BLOCK_SIZE;
+    enc->pos = enc->end = window;
+    enc->in_total = enc->out_total = 0;
+    enc->acc = 0;
+    enc->nbits = 0;
+    enc->nstaged = enc->sent = 0;
+    enc->flushed = false;
+
+    /* History before the start of the input reads as zeros */
+    enc->buffer = calloc(enc->size, 1);
+    if (enc->buffer == NULL) {
+      free(enc);
+      enc = NULL;
+    }
+  }
+  return enc;
+}
+
+void gkencoder_destroy(_Optional GKEncoder *enc)
+{
+  if (enc != NULL) {
+    free(enc->buffer);
+    free(enc);
+  }
+}
+
+void gkencoder_resume(GKEncoder *enc, const unsigned char *history,
+                      size_t in_total, size_t out_bytes, unsigned int out_bits,
+                      unsigned int partial)
+{
+  const size_t window = (size_t)1 << enc->history_log_2;
+  const size_t nhistory = in_total < window ? in_total : window;
+
+  assert(enc != NULL);
+  assert(history != NULL || nhistory == 0);
+  assert(enc->in_total == 0);
+  assert(enc->end == enc->pos);
+  assert(out_bits < 8);
+
+  /* History before the start of the input still reads as zeros */
+  if (nhistory > 0)
+    memcpy(enc->buffer + window - nhistory, history - nhistory, nhistory);
+  enc->in_total = in_total;
+  enc->out_total = out_bytes;
+  enc->acc = partial & ((1u << out_bits) - 1);
+  enc->nbits = out_bits;
+}
+
+void gkencoder_tell(const GKEncoder *enc, size_t *in_total, size_t *out_bytes,
+                    unsigned int *out_bits)
+{
+  assert(enc != NULL);
+  assert(in_total != NULL);
+  assert(out_bytes != NULL);
+  assert(out_bits != NULL);
+
+  /* Whole bytes may still be held in the accumulator */
+  *in_total = enc->in_total;
+  *out_bytes = enc->out_total + enc->nbits / 8;
+  *out_bits = enc->nbits % 8;
+}
+
+GKeyStatus gkencoder_compress(GKEncoder *enc, GKeyParameters *params)
+{
+  const bool final = params->in_size == 0;
+
+  assert(enc != NULL);
+  assert(params != NULL);
+  assert(params->out_buffer != NULL || params->out_size == 0);
+  assert(params->in_buffer != NULL || params->in_size == 0);
+
+  for (;;) {
+    /* Parse no more input until the output of the last batch has gone */
+    if (!send_staged(enc, params))
+      return GKeyStatus_BufferOverflow;
+
+    fill_buffer(enc, params);
+
+    if (put_batch(enc, final)) {
+      if (params->prog_cb != NULL &&
+          !params->prog_cb(params->cb_arg, enc->in_total, enc->out_total))
+        return GKeyStatus_Aborted;
+    } else if (params->in_size > 0) {
+      /* The buffer is full of input that can't be parsed yet */
+      slide_buffer(enc);
+    } else {
+      break;
+    }
+  }
+
+  if (!final)
+    return GKeyStatus_OK;
+
+  if (!enc->flushed) {
+    /* Stage the last few bits, padded with zeros to a whole byte */
+    while (enc->nbits > 0) {
+      enc->staged[enc->nstaged++] = (unsigned char)enc->acc;
+      ++enc->out_total;
+      enc->acc >>= 8;
+      enc->nbits = enc->nbits > 8 ? enc->nbits - 8 : 0;
+    }
+    enc->flushed = true;
+  }
+
+  return send_staged(enc, params) ? GKeyStatus_Finished
+                                  : GKeyStatus_BufferOverflow;
+}
@@ -0,0 +1,53 @@
+/*
+ *  Gordon Key file compression utilities
+ *  Compression with a choice of effort
+ *  Copyright (C) 2026 Christopher Bazley
+ */
+
+#ifndef GKENCODER_H
+#define GKENCODER_H
+
+/* GKeyLib headers */
+#include "GKeyComp.h"
+
+/* Local headers */
+#include "misc.h"
+
+enum {
+  GKENCODER_MAX_LOG_2 = 16 /* Largest history size supported */
+};
+
+typedef struct GKEncoder GKEncoder;
+
+/* Create a compressor for the given history size, using the parsing strategy
+   for a compression level between GKPARSE_MIN_LEVEL and GKPARSE_MAX_LEVEL.
+   The output is in the same format as for gkeycomp_make. */
+_Optional GKEncoder *gkencoder_make(unsigned int history_log_2,
+                                    unsigned int level);
+
+void gkencoder_destroy(_Optional GKEncoder *enc);
+
+/* Make a new encoder continue from a point at which an earlier one had
+   consumed 'in_total' bytes of input, ending at the start of a directive,
+   and produced 'out_bytes' whole bytes plus 'out_bits' bits of output. The
+   bits are the least significant bits of 'partial', and 'history' points to
+   the end of the input consumed (of which up to one history size is read).
+   The output then continues from that partial byte. */
+void gkencoder_resume(GKEncoder *enc, const unsigned char *history,
+                      size_t in_total, size_t out_bytes, unsigned int out_bits,
+                      unsigned int partial);
+
+/* Get the amount of input consumed and output produced so far, in the form
+   accepted by gkencoder_resume. Between calls to gkencoder_compress, the
+   input consumed always ends at the start of a directive. */
+void gkencoder_tell(const GKEncoder *enc, size_t *in_total, size_t *out_bytes,
+                    unsigned int *out_bits);
+
+/* Compress data in the same way as gkeycomp_compress: input is consumed and
+   output produced until one of the buffers is exhausted. Returns
+   GKeyStatus_BufferOverflow if the output buffer is full. If the input
+   buffer is empty then any pending output is flushed and the return value is
+   GKeyStatus_Finished once that is complete. */
+GKeyStatus gkencoder_compress(GKEncoder *enc, GKeyParameters *params);
+
+#endif /* GKENCODER_H */
@@ -0,0 +1,253 @@
+/*
+ *  Gordon Key file compression utilities
+ *  Estimation of compressed size from a sample of the input
+ *  Copyright (C) 2026 Christopher Bazley
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public Licence as published by
+ *  the Free Software Foundation; either version 2 of the Licence, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public Licence for more details.
+ *
+ *  You should have received a copy of the GNU General Public Licence
+ *  along with this program; if not, write to the Free Software
+ *  Foundation, Inc., 675 Mass Ave, Cambridge, MA 02139, USA.
+ */
+
+/* ISO library header files */
+#include <assert.h>
+#include <errno.h>
+#include <math.h>
+#include <stdbool.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+/* Local headers */
+#include "gkestimate.h"
+#include "gkparse.h"
+#include "gktrace.h"
+#include "misc.h"
+
+enum {
+  FEDNET_HEADER_SIZE = 4, /* No. of bytes in a 32 bit integer */
+  BLOCK_SIZE = 4096,      /* No. of bytes in each block parsed */
+  MAX_BLOCKS = 32,        /* Maximum no. of blocks parsed per file */
+  NUM_HISTORIES = GKESTIMATE_MAX_LOG_2 + 1
+};
+
+#define Z_95 1.96 /* Standard normal quantile for 95% confidence */
+
+typedef struct {
+  size_t nblocks; /* No. of blocks parsed so far */
+  unsigned long in_bytes[MAX_BLOCKS];
+  unsigned long out_bits[NUM_HISTORIES][MAX_BLOCKS];
+  GKParseStats totals[NUM_HISTORIES];
+} Sample;
+
+static size_t sample_size(unsigned long total)
+{
+  return total < MAX_BLOCKS ? (size_t)total : MAX_BLOCKS;
+}
+
+static unsigned long block_index(size_t i, size_t nsample,
+                                 unsigned long total)
+{
+  /* Spread the sample evenly, including the first and last blocks. If every
+     block is in the sample then this is the identity. */
+  if (nsample <= 1)
+    return 0;
+
+  return (unsigned long)((double)i * (total - 1) / (nsample - 1));
+}
+
+static void add_block(Sample *sample, const unsigned char *data, size_t size,
+                      unsigned int min_log_2, unsigned int max_log_2)
+{
+  unsigned int h;
+
+  assert(sample->nblocks < MAX_BLOCKS);
+
+  GKTRACE_BEGIN("parse");
+  for (h = min_log_2; h <= max_log_2; ++h) {
+    GKParseStats stats = {0, 0, 0};
+
+    gkparse_greedy(data, size, h, &stats);
+    sample->out_bits[h][sample->nblocks] = stats.bits;
+    sample->totals[h].literals += stats.literals;
+    sample->totals[h].copied += stats.copied;
+    sample->totals[h].bits += stats.bits;
+  }
+  GKTRACE_END("parse");
+
+  sample->in_bytes[sample->nblocks++] = (unsigned long)size;
+}
+
+static double ratio_for(double bits_per_byte, long int size)
+{
+  /* Get the compressed size as a percentage, including the header */
+  return (FEDNET_HEADER_SIZE + bits_per_byte * size / 8) * 100 / size;
+}
+
+static void finish(const Sample *sample, unsigned long total, long int size,
+                   unsigned int h, GKEstimate *estimate)
+{
+  /* Extrapolate using the ratio of the sample's output to its input. The
+     variance comes from each block's deviation from that ratio, with a
+     correction for the fraction of the file that was sampled. */
+  const size_t n = sample->nblocks;
+  unsigned long in_total = 0;
+  double bits_per_byte, error = 0.0;
+  size_t k;
+
+  estimate->size = size;
+
+  if (n == 0) {
+    estimate->sampled = 0;
+    estimate->copied = estimate->ratio = 0.0;
+    estimate->ratio_low = estimate->ratio_high = 0.0;
+    estimate->out_size = FEDNET_HEADER_SIZE;
+    return;
+  }
+
+  for (k = 0; k < n; ++k)
+    in_total += sample->in_bytes[k];
+
+  bits_per_byte = (double)sample->totals[h].bits / in_total;
+
+  if (n > 1 && n < total) {
+    const double mean_in = (double)in_total / n;
+    double sum_sq = 0.0;
+
+    for (k = 0; k < n; ++k) {
+      const double dev =
+        sample->out_bits[h][k] - bits_per_byte * sample->in_bytes[k];
+      sum_sq += dev * dev;
+    }
+
+    error = Z_95 *
+            sqrt((1.0 - (double)n / total) * sum_sq / (n - 1) / n) / mean_in;
+  }
+
+  estimate->sampled = (long int)in_total;
+  estimate->copied = (double)sample->totals[h].copied * 100 / in_total;
+  estimate->ratio = ratio_for(bits_per_byte, size);
+  estimate->ratio_low =
+    ratio_for(bits_per_byte > error ? bits_per_byte - error : 0.0, size);
+  estimate->ratio_high = ratio_for(bits_per_byte + error, size);
+  estimate->out_size = FEDNET_HEADER_SIZE +
+                       (long int)ceil(bits_per_byte * size / 8);
+}
+
+bool gkestimate_file(FILE *in, unsigned int min_log_2, unsigned int max_log_2,
+                     GKEstimate estimates[])
+{
+  const size_t window = (size_t)1 << max_log_2;
+  _Optional Sample *sample = NULL;
+  _Optional unsigned char *buffer = NULL;
+  unsigned long total;
+  size_t i, nsample;
+  long int len;
+  bool success = true;
+  unsigned int h;
+
+  assert(in != NULL);
+  assert(min_log_2 <= max_log_2);
+  assert(max_log_2 <= GKESTIMATE_MAX_LOG_2);
+  assert(estimates != NULL);
+
+  if (fseek(in, 0, SEEK_END)) {
+    fprintf(stderr, "Failed to seek end of input\n");
+    return false;
+  }
+
+  len = ftell(in);
+  if (len == -1L) {
+    fprintf(stderr, "Failed to tell input file position\n");
+    return false;
+  }
+
+  total = ((unsigned long)len + BLOCK_SIZE - 1) / BLOCK_SIZE;
+  nsample = sample_size(total);
+
+  /* Each block is read after the history that precedes it */
+  sample = calloc(1, sizeof(*sample));
+  buffer = malloc(window + BLOCK_SIZE);
+  if (sample == NULL || buffer == NULL) {
+    fprintf(stderr, "Failed to allocate memory: %s\n", strerror(errno));
+    success = false;
+  }
+
+  for (i = 0; i < nsample && success; ++i) {
+    const long int offset = (long int)block_index(i, nsample, total) *
+                            BLOCK_SIZE;
+    const size_t size =
+      len - offset < BLOCK_SIZE ? (size_t)(len - offset) : BLOCK_SIZE;
+    const size_t history =
+      (unsigned long)offset < window ? (size_t)offset : window;
+    const size_t nread = history + size;
+
+    /* History before the start of the file reads as zeros */
+    memset(&*buffer, 0, window - history);
+
+    if (fseek(in, offset - (long int)history, SEEK_SET)) {
+      fprintf(stderr, "Failed to seek sample at offset %ld\n", offset);
+      success = false;
+    } else if (fread(&*buffer + window - history, 1, nread, in) != nread) {
+      fprintf(stderr, "Failed to read sample at offset %ld: %s\n", offset,
+              ferror(in) ? strerror(errno) : "unexpected end of file");
+      success = false;
+    } else {
+      add_block(&*sample, &*buffer + window, size, min_log_2, max_log_2);
+    }
+  }
+
+  if (success) {
+    for (h = min_log_2; h <= max_log_2; ++h)
+      finish(&*sample, total, len, h, &estimates[h - min_log_2]);
+  }
+
+  free(buffer);
+  free(sample);
+  return success;
+}
+
+bool gkestimate_buffer(const unsigned char *data, size_t size,
+                       unsigned int min_log_2, unsigned int max_log_2,
+                       GKEstimate estimates[])
+{
+  _Optional Sample *const sample = calloc(1, sizeof(*sample));
+  const unsigned long total =
+    ((unsigned long)size + BLOCK_SIZE - 1) / BLOCK_SIZE;
+  const size_t nsample = sample_size(total);
+  size_t i;
+  unsigned int h;
+
+  assert(data != NULL || size == 0);
+  assert(min_log_2 <= max_log_2);
+  assert(max_log_2 <= GKESTIMATE_MAX_LOG_2);
+  assert(estimates != NULL);
+
+  if (sample == NULL) {
+    fprintf(stderr, "Failed to allocate memory: %s\n", strerror(errno));
+    return false;
+  }
+
+  for (i = 0; i < nsample; ++i) {
+    const size_t offset = block_index(i, nsample, total) * BLOCK_SIZE;
+
+    add_block(&*sample, data + offset,
+              size - offset < BLOCK_SIZE ? size - offset : BLOCK_SIZE,
+              min_log_2, max_log_2);
+  }
+
+  for (h = min_log_2; h <= max_log_2; ++h)
+    finish(&*sample, total, (long int)size, h, &estimates[h - min_log_2]);
+
+  free(sample);
+  return true;
+}
@@ -0,0 +1,47 @@
+/*
+ *  Gordon Key file compression utilities
+ *  Estimation of compressed size from a sample of the input
+ *  Copyright (C) 2026 Christopher Bazley
+ */
+
+#ifndef GKESTIMATE_H
+#define GKESTIMATE_H
+
+/* ISO library header files */
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdio.h>
+
+/* Local headers */
+#include "gkmatch.h"
+
+enum {
+  GKESTIMATE_MAX_LOG_2 = GKMATCH_SPECIALISED_MAX_LOG_2 /* Largest history
+                                                          size supported */
+};
+
+typedef struct {
+  long int size;       /* No. of bytes of input */
+  long int sampled;    /* No. of bytes of input that were parsed */
+  double copied;       /* Percentage of the sample output by copy
+                          directives (the rest being literals) */
+  double ratio;        /* Compressed size as a percentage of 'size' */
+  double ratio_low;    /* Lower and upper bounds of the 95% confidence */
+  double ratio_high;   /* interval for 'ratio', from sampling error alone */
+  long int out_size;   /* Compressed size in bytes, including the header */
+} GKEstimate;
+
+/* Estimate the compressed size of a seekable file for each history size
+   from 'min_log_2' to 'max_log_2' by parsing blocks spread evenly through
+   it, and store the results in consecutive elements of 'estimates'. Small
+   files are parsed in full. Prints a message and returns false on failure. */
+bool gkestimate_file(FILE *in, unsigned int min_log_2, unsigned int max_log_2,
+                     GKEstimate estimates[]);
+
+/* As gkestimate_file, but for 'size' bytes in memory. The history before
+   'data' must be readable and zero, as for gkmatch_find. */
+bool gkestimate_buffer(const unsigned char *data, size_t size,
+                       unsigned int min_log_2, unsigned int max_log_2,
+                       GKEstimate estimates[]);
+
+#endif /* GKESTIMATE_H */
@@ -0,0 +1,529 @@
+/*
+ *  Gordon Key file compression utilities
+ *  Match search for small history buffers
+ *  Copyright (C) 2026 Christopher Bazley
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public Licence as published by
+ *  the Free Software Foundation; either version 2 of the Licence, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public Licence for more details.
+ *
+ *  You should have received a copy of the GNU General Public Licence
+ *  along with this program; if not, write to the Free Software
+ *  Foundation, Inc., 675 Mass Ave, Cambridge, MA 02139, USA.
+ */
+
+/* ISO library header files */
+#include <assert.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#if defined(__SSE2__) || defined(_M_X64) ||                                    \
+  (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#include <emmintrin.h>
+#define GKMATCH_SSE2
+#elif defined(__ARM_NEON)
+#include <arm_neon.h>
+#define GKMATCH_NEON
+#endif
+
+#if (defined(__GNUC__) || defined(__clang__)) && defined(GKMATCH_SSE2)
+#include <immintrin.h>
+#define GKMATCH_AVX2
+#define TARGET_AVX2 __attribute__((target("avx2")))
+#endif
+
+#ifdef _MSC_VER
+#include <intrin.h>
+#endif
+
+/* Local headers */
+#include "gkcpu.h"
+#include "gkmatch.h"
+#include "misc.h"
+
+/* The search functions are written once and instantiated for each history
+   size by inlining them into functions that pass a constant. */
+#if defined(__GNUC__) || defined(__clang__)
+#define ALWAYS_INLINE inline __attribute__((always_inline))
+#elif defined(_MSC_VER)
+#define ALWAYS_INLINE __forceinline
+#else
+#define ALWAYS_INLINE
+#endif
+
+static unsigned int lowest_bit(uint64_t mask)
+{
+  assert(mask != 0);
+#if defined(__GNUC__) || defined(__clang__)
+  return (unsigned int)__builtin_ctzll(mask);
+#elif defined(_MSC_VER) && defined(_M_X64)
+  unsigned long index;
+  _BitScanForward64(&index, mask);
+  return (unsigned int)index;
+#else
+  unsigned int index = 0;
+  while (!(mask & 1)) {
+    mask >>= 1;
+    ++index;
+  }
+  return index;
+#endif
+}
+
+static unsigned int highest_bit(uint64_t mask)
+{
+  assert(mask != 0);
+#if defined(__GNUC__) || defined(__clang__)
+  return 63u - (unsigned int)__builtin_clzll(mask);
+#elif defined(_MSC_VER) && defined(_M_X64)
+  unsigned long index;
+  _BitScanReverse64(&index, mask);
+  return (unsigned int)index;
+#else
+  unsigned int index = 0;
+  while (mask >>= 1)
+    ++index;
+  return index;
+#endif
+}
+
+static ALWAYS_INLINE unsigned int max_length(unsigned int distance,
+                                             unsigned int history_log_2)
+{
+  const unsigned int window = 1u << history_log_2;
+
+  assert(distance > 0);
+  assert(distance <= window);
+
+  /* Copies from the more recent half of the history buffer have one bit
+     fewer to encode their length. */
+  if (history_log_2 > 0 && distance <= window / 2)
+    return window / 2 - 1;
+
+  return window - 1;
+}
+
+unsigned int gkmatch_max_length(unsigned int distance,
+                                unsigned int history_log_2)
+{
+  return max_length(distance, history_log_2);
+}
+
+unsigned int gkmatch_copy_bits(unsigned int distance,
+                               unsigned int history_log_2)
+{
+  /* Type bit, offset and length */
+  const unsigned int window = 1u << history_log_2;
+  return 1 + history_log_2 + history_log_2 -
+         (history_log_2 > 0 && distance <= window / 2 ? 1 : 0);
+}
+
+static ALWAYS_INLINE unsigned int limit_length(unsigned int distance,
+                                               size_t avail,
+                                               unsigned int history_log_2)
+{
+  const unsigned int limit = max_length(distance, history_log_2);
+  return limit > avail ? (unsigned int)avail : limit;
+}
+
+static ALWAYS_INLINE GKMatch find_scalar(const unsigned char *data,
+                                         size_t avail,
+                                         unsigned int history_log_2)
+{
+  GKMatch best = {0, 0};
+  unsigned int distance;
+
+  assert(data != NULL);
+
+  /* Visit the furthest candidate first so that the nearest wins a tie */
+  for (distance = 1u << history_log_2; distance > 0; --distance) {
+    const unsigned char *const src = data - distance;
+    const unsigned int limit = limit_length(distance, avail, history_log_2);
+    unsigned int len = 0;
+
+    while (len < limit && src[len] == data[len])
+      ++len;
+
+    if (len > 0 && len >= best.length) {
+      best.distance = distance;
+      best.length = len;
+    }
+  }
+
+  return best;
+}
+
+GKMatch gkmatch_find_scalar(const unsigned char *data, size_t avail,
+                            unsigned int history_log_2)
+{
+  return find_scalar(data, avail, history_log_2);
+}
+
+static ALWAYS_INLINE GKMatch find_bounded(const unsigned char *data,
+                                          size_t avail,
+                                          unsigned int history_log_2,
+                                          unsigned int max_candidates)
+{
+  const unsigned int window = 1u << history_log_2;
+  const unsigned int longest = limit_length(window, avail, history_log_2);
+  GKMatch best = {0, 0};
+  unsigned int distance, count = 0;
+
+  assert(data != NULL);
+
+  if (avail < 2) {
+    /* At most one byte can be copied, so take the nearest that matches */
+    for (distance = 1; distance <= window && avail > 0; ++distance) {
+      if (limit_length(distance, avail, history_log_2) > 0 &&
+          data[-(ptrdiff_t)distance] == data[0]) {
+        best.distance = distance;
+        best.length = 1;
+        break;
+      }
+    }
+    return best;
+  }
+
+  for (distance = 1; distance <= window; ++distance) {
+    const unsigned char *const src = data - distance;
+    unsigned int limit, len;
+
+    if (src[0] != data[0])
+      continue;
+
+    limit = limit_length(distance, avail, history_log_2);
+    len = 0;
+    while (len < limit && src[len] == data[len])
+      ++len;
+
+    /* Keep the nearest of several matches of the same length */
+    if (len > best.length) {
+      best.distance = distance;
+      best.length = len;
+    }
+
+    if ((len >= 2 && ++count >= max_candidates) || best.length >= longest)
+      break;
+  }
+
+  return best;
+}
+
+#if defined(GKMATCH_SSE2) || defined(GKMATCH_NEON)
+
+#define TARGET
+#define BLOCK_SIZE 16
+
+#ifdef GKMATCH_SSE2
+
+#define VECTOR(name) name##_sse2
+#define Vector __m128i
+#define LANE_SHIFT 0
+#define LANE_MASK ((uint64_t)0x1)
+#define ALL_LANES ((uint64_t)0xffff)
+
+static Vector load_sse2(const unsigned char *p)
+{
+  return _mm_loadu_si128((const __m128i *)(const void *)p);
+}
+
+static Vector splat_sse2(unsigned char c)
+{
+  return _mm_set1_epi8((char)c);
+}
+
+static uint64_t equal_mask_sse2(Vector a, Vector b)
+{
+  return (uint64_t)(unsigned int)_mm_movemask_epi8(_mm_cmpeq_epi8(a, b));
+}
+
+#else /* GKMATCH_NEON */
+
+#define VECTOR(name) name##_neon
+#define Vector uint8x16_t
+#define LANE_SHIFT 2
+#define LANE_MASK ((uint64_t)0xf)
+#define ALL_LANES (~(uint64_t)0)
+
+static Vector load_neon(const unsigned char *p)
+{
+  return vld1q_u8(p);
+}
+
+static Vector splat_neon(unsigned char c)
+{
+  return vdupq_n_u8(c);
+}
+
+static uint64_t equal_mask_neon(Vector a, Vector b)
+{
+  /* NEON has no equivalent of movemask, so narrow each byte of the
+     comparison result to a nybble instead */
+  const uint8x8_t narrow =
+    vshrn_n_u16(vreinterpretq_u16_u8(vceqq_u8(a, b)), 4);
+  return vget_lane_u64(vreinterpret_u64_u8(narrow), 0);
+}
+
+#endif /* GKMATCH_NEON */
+
+#include "gkmatchv.h"
+
+#undef TARGET
+#undef BLOCK_SIZE
+#undef VECTOR
+#undef Vector
+#undef LANE_SHIFT
+#undef LANE_MASK
+#undef ALL_LANES
+
+#endif /* GKMATCH_SSE2 || GKMATCH_NEON */
+
+static ALWAYS_INLINE GKMatch find_any(const unsigned char *data,
+                                      size_t avail,
+                                      unsigned int history_log_2)
+{
+  assert(data != NULL);
+
+  if (history_log_2 >= GKMATCH_SIMD_MIN_LOG_2 &&
+      history_log_2 <= GKMATCH_SIMD_MAX_LOG_2 && avail >= 2) {
+#if defined(GKMATCH_SSE2)
+    return find_sse2(data, avail, history_log_2);
+#elif defined(GKMATCH_NEON)
+    return find_neon(data, avail, history_log_2);
+#endif
+  }
+
+  return find_scalar(data, avail, history_log_2);
+}
+
+#ifdef GKMATCH_AVX2
+
+enum {
+  AVX2_MIN_LOG_2 = 5 /* Smallest history that is a whole no. of blocks */
+};
+
+#define TARGET TARGET_AVX2
+#define BLOCK_SIZE 32
+#define VECTOR(name) name##_avx2
+#define Vector __m256i
+#define LANE_SHIFT 0
+#define LANE_MASK ((uint64_t)0x1)
+#define ALL_LANES ((uint64_t)0xffffffff)
+
+static TARGET Vector load_avx2(const unsigned char *p)
+{
+  return _mm256_loadu_si256((const __m256i *)(const void *)p);
+}
+
+static TARGET Vector splat_avx2(unsigned char c)
+{
+  return _mm256_set1_epi8((char)c);
+}
+
+static TARGET uint64_t equal_mask_avx2(Vector a, Vector b)
+{
+  return (uint64_t)(uint32_t)_mm256_movemask_epi8(_mm256_cmpeq_epi8(a, b));
+}
+
+#include "gkmatchv.h"
+
+static ALWAYS_INLINE TARGET GKMatch find_any_avx2(const unsigned char *data,
+                                                  size_t avail,
+                                                  unsigned int history_log_2)
+{
+  assert(data != NULL);
+
+  if (history_log_2 >= AVX2_MIN_LOG_2 &&
+      history_log_2 <= GKMATCH_SIMD_MAX_LOG_2 && avail >= 2)
+    return find_avx2(data, avail, history_log_2);
+
+  /* The history is too small for one block or too big to be worth it */
+  return find_any(data, avail, history_log_2);
+}
+
+#undef TARGET
+#undef BLOCK_SIZE
+#undef VECTOR
+#undef Vector
+#undef LANE_SHIFT
+#undef LANE_MASK
+#undef ALL_LANES
+
+#endif /* GKMATCH_AVX2 */
+
+typedef GKMatch FindFn(const unsigned char *data, size_t avail);
+
+typedef GKMatch FindAnyFn(const unsigned char *data, size_t avail,
+                          unsigned int history_log_2);
+
+typedef struct {
+  FindAnyFn *any;
+  FindFn *specialised[GKMATCH_SPECIALISED_MAX_LOG_2 + 1];
+} Kernel;
+
+/* Define a generic function and one for each history size that calls
+   the given search function, which must be inlined. */
+#define SPECIALISE(FN, ATTR, N)                                                \
+  static ATTR GKMatch FN##_##N(const unsigned char *data, size_t avail)       \
+  {                                                                            \
+    return FN(data, avail, N);                                                 \
+  }
+
+#define INSTANTIATE(FN, ATTR)                                                  \
+  static ATTR GKMatch FN##_generic(const unsigned char *data, size_t avail,    \
+                                   unsigned int history_log_2)                 \
+  {                                                                            \
+    return FN(data, avail, history_log_2);                                     \
+  }                                                                            \
+  SPECIALISE(FN, ATTR, 0)                                                      \
+  SPECIALISE(FN, ATTR, 1)                                                      \
+  SPECIALISE(FN, ATTR, 2)                                                      \
+  SPECIALISE(FN, ATTR, 3)                                                      \
+  SPECIALISE(FN, ATTR, 4)                                                      \
+  SPECIALISE(FN, ATTR, 5)                                                      \
+  SPECIALISE(FN, ATTR, 6)                                                      \
+  SPECIALISE(FN, ATTR, 7)                                                      \
+  SPECIALISE(FN, ATTR, 8)                                                      \
+  SPECIALISE(FN, ATTR, 9)                                                      \
+  SPECIALISE(FN, ATTR, 10)                                                     \
+  SPECIALISE(FN, ATTR, 11)                                                     \
+  SPECIALISE(FN, ATTR, 12)                                                     \
+  SPECIALISE(FN, ATTR, 13)                                                     \
+  SPECIALISE(FN, ATTR, 14)                                                     \
+  SPECIALISE(FN, ATTR, 15)                                                     \
+  SPECIALISE(FN, ATTR, 16)
+
+#define KERNEL(FN)                                                             \
+  {                                                                            \
+    FN##_generic,                                                              \
+    {                                                                          \
+      FN##_0, FN##_1, FN##_2, FN##_3, FN##_4, FN##_5, FN##_6, FN##_7, FN##_8,  \
+      FN##_9, FN##_10, FN##_11, FN##_12, FN##_13, FN##_14, FN##_15, FN##_16    \
+    }                                                                          \
+  }
+
+/* The bounded search visits candidates one at a time, nearest first, so it
+   has no vector implementation, but it is specialised for each history size
+   in the same way. */
+typedef GKMatch FindBoundedFn(const unsigned char *data, size_t avail,
+                              unsigned int max_candidates);
+
+#define SPECIALISE_BOUNDED(N)                                                  \
+  static GKMatch find_bounded_##N(const unsigned char *data, size_t avail,    \
+                                  unsigned int max_candidates)                \
+  {                                                                            \
+    return find_bounded(data, avail, N, max_candidates);                       \
+  }
+
+SPECIALISE_BOUNDED(0)
+SPECIALISE_BOUNDED(1)
+SPECIALISE_BOUNDED(2)
+SPECIALISE_BOUNDED(3)
+SPECIALISE_BOUNDED(4)
+SPECIALISE_BOUNDED(5)
+SPECIALISE_BOUNDED(6)
+SPECIALISE_BOUNDED(7)
+SPECIALISE_BOUNDED(8)
+SPECIALISE_BOUNDED(9)
+SPECIALISE_BOUNDED(10)
+SPECIALISE_BOUNDED(11)
+SPECIALISE_BOUNDED(12)
+SPECIALISE_BOUNDED(13)
+SPECIALISE_BOUNDED(14)
+SPECIALISE_BOUNDED(15)
+SPECIALISE_BOUNDED(16)
+
+static FindBoundedFn *const bounded[GKMATCH_SPECIALISED_MAX_LOG_2 + 1] = {
+  find_bounded_0,  find_bounded_1,  find_bounded_2,  find_bounded_3,
+  find_bounded_4,  find_bounded_5,  find_bounded_6,  find_bounded_7,
+  find_bounded_8,  find_bounded_9,  find_bounded_10, find_bounded_11,
+  find_bounded_12, find_bounded_13, find_bounded_14, find_bounded_15,
+  find_bounded_16
+};
+
+#define NO_TARGET
+
+INSTANTIATE(find_scalar, NO_TARGET)
+
+#if defined(GKMATCH_SSE2) || defined(GKMATCH_NEON)
+INSTANTIATE(find_any, NO_TARGET)
+#endif
+
+#ifdef GKMATCH_AVX2
+INSTANTIATE(find_any_avx2, TARGET_AVX2)
+#endif
+
+/* Implementations of the search for each code path, or null if the path
+   was not compiled. */
+static const Kernel kernels[GKCpu_Count] = {
+  [GKCpu_Scalar] = KERNEL(find_scalar),
+#if defined(GKMATCH_SSE2)
+  [GKCpu_SSE2] = KERNEL(find_any),
+#elif defined(GKMATCH_NEON)
+  [GKCpu_NEON] = KERNEL(find_any),
+#endif
+#ifdef GKMATCH_AVX2
+  [GKCpu_AVX2] = KERNEL(find_any_avx2),
+#endif
+};
+
+static _Optional const Kernel *kernel; /* Chosen on first use */
+
+void gkmatch_select(void)
+{
+  unsigned int compiled = 0;
+  GKCpuPath path;
+
+  for (path = GKCpu_Scalar; path < GKCpu_Count; ++path) {
+    if (kernels[path].any != NULL)
+      compiled |= 1u << path;
+  }
+
+  kernel = &kernels[gkcpu_select("match search", compiled)];
+}
+
+static const Kernel *get_kernel(void)
+{
+  if (kernel == NULL)
+    gkmatch_select();
+
+  return &*kernel;
+}
+
+GKMatch gkmatch_find_generic(const unsigned char *data, size_t avail,
+                             unsigned int history_log_2)
+{
+  return get_kernel()->any(data, avail, history_log_2);
+}
+
+GKMatch gkmatch_find(const unsigned char *data, size_t avail,
+                     unsigned int history_log_2)
+{
+  const Kernel *const k = get_kernel();
+
+  if (history_log_2 <= GKMATCH_SPECIALISED_MAX_LOG_2)
+    return k->specialised[history_log_2](data, avail);
+
+  return k->any(data, avail, history_log_2);
+}
+
+GKMatch gkmatch_find_bounded(const unsigned char *data, size_t avail,
+                             unsigned int history_log_2,
+                             unsigned int max_candidates)
+{
+  assert(data != NULL);
+
+  if (max_candidates == 0)
+    return gkmatch_find(data, avail, history_log_2);
+
+  if (history_log_2 <= GKMATCH_SPECIALISED_MAX_LOG_2)
+    return bounded[history_log_2](data, avail, max_candidates);
+
+  return find_bounded(data, avail, history_log_2, max_candidates);
+}
@@ -0,0 +1,74 @@
+/*
+ *  Gordon Key file compression utilities
+ *  Match search for small history buffers
+ *  Copyright (C) 2026 Christopher Bazley
+ */
+
+#ifndef GKMATCH_H
+#define GKMATCH_H
+
+/* ISO library header files */
+#include <stddef.h>
+
+enum {
+  GKMATCH_LITERAL_BITS = 9,   /* No. of bits to encode a literal byte */
+  GKMATCH_SIMD_MIN_LOG_2 = 4, /* Smallest history searched using vectors */
+  GKMATCH_SIMD_MAX_LOG_2 = 12, /* Largest history searched using vectors */
+  GKMATCH_SPECIALISED_MAX_LOG_2 = 16 /* Largest history for which the
+                                        search is compiled separately */
+};
+
+typedef struct {
+  unsigned int distance; /* No. of bytes behind the current position
+                            (1 to the history size), or 0 if no match */
+  unsigned int length;   /* No. of bytes that can be copied, or 0 */
+} GKMatch;
+
+/* Find the longest sequence that can be copied to the current position
+   'data' by a single directive with the given history size. The length of
+   a match is limited by the width of the length field that would be used
+   to encode it, and by 'avail', the number of bytes from 'data' onwards.
+   Where several matches have the same length, the nearest is preferred.
+
+   The history (2^history_log_2 bytes before 'data') must be readable. Any
+   part of it preceding the start of the input should be zero, as when
+   decompressing. */
+GKMatch gkmatch_find(const unsigned char *data, size_t avail,
+                     unsigned int history_log_2);
+
+/* Equivalent to gkmatch_find but without code specialised for the history
+   size. This is only useful for comparison. */
+GKMatch gkmatch_find_generic(const unsigned char *data, size_t avail,
+                             unsigned int history_log_2);
+
+/* Reference implementation of gkmatch_find, which must give the same
+   results. */
+GKMatch gkmatch_find_scalar(const unsigned char *data, size_t avail,
+                            unsigned int history_log_2);
+
+/* Choose the implementations of gkmatch_find and gkmatch_find_generic for
+   the CPU, subject to any limit set by gkcpu_init. This is done on first
+   use, but must be repeated if the limit is changed afterwards. */
+void gkmatch_select(void);
+
+/* Find a sequence that can be copied to the current position 'data' with
+   bounded effort. Candidates are visited nearest first, and the search stops
+   after 'max_candidates' positions where at least two bytes match (or
+   earlier, if a match of the maximum length is found). If 'max_candidates'
+   is 0 then the search is exhaustive and the result is the same as for
+   gkmatch_find. */
+GKMatch gkmatch_find_bounded(const unsigned char *data, size_t avail,
+                             unsigned int history_log_2,
+                             unsigned int max_candidates);
+
+/* Get the maximum number of bytes that can be copied by a single directive
+   from the given distance behind the current position. */
+unsigned int gkmatch_max_length(unsigned int distance,
+                                unsigned int history_log_2);
+
+/* Get the number of bits needed to encode a directive to copy bytes from
+   the given distance behind the current position. */
+unsigned int gkmatch_copy_bits(unsigned int distance,
+                               unsigned int history_log_2);
+
+#endif /* GKMATCH_H */
@@ -0,0 +1,222 @@
+/*
+ *  Gordon Key file compression utilities
+ *  Match search unit test
+ *  Copyright (C) 2026 Christopher Bazley
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public Licence as published by
+ *  the Free Software Foundation; either version 2 of the Licence, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public Licence for more details.
+ *
+ *  You should have received a copy of the GNU General Public Licence
+ *  along with this program; if not, write to the Free Software
+ *  Foundation, Inc., 675 Mass Ave, Cambridge, MA 02139, USA.
+ */
+
+/* ISO library header files */
+#include <limits.h>
+#include <stdbool.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+/* Local headers */
+#include "gkcpu.h"
+#include "gkmatch.h"
+#include "misc.h"
+
+enum {
+  MAX_HISTORY_LOG_2 = GKMATCH_SPECIALISED_MAX_LOG_2,
+  FULL_MAX_LOG_2 = GKMATCH_SIMD_MAX_LOG_2 + 1, /* Largest history tested at
+                                                  every position */
+  HISTORY_SIZE = 1 << MAX_HISTORY_LOG_2,
+  DATA_SIZE = 12 * 1024, /* No. of bytes of test data per pattern */
+  FEW_CANDIDATES = 4,    /* Effort limit for bounded searches */
+  LARGE_STEP = 509,      /* Minimum no. of bytes to advance when the
+                            history is too big to search everywhere */
+  LARGE_AVAIL = 32       /* Maximum match length in that case */
+};
+
+typedef enum {
+  Pattern_Random,
+  Pattern_FewSymbols,
+  Pattern_Text,
+  Pattern_Zeros,
+  Pattern_Count
+} Pattern;
+
+static const char *const pattern_names[Pattern_Count] = {
+  "random", "few symbols", "text", "zeros"};
+
+static unsigned long seed = 1;
+
+static unsigned int pseudo_random(void)
+{
+  /* Deliberately not rand() so that the data is the same everywhere */
+  seed = (seed * 1103515245ul + 12345ul) & 0x7ffffffful;
+  return (unsigned int)(seed >> 16);
+}
+
+static void make_data(unsigned char *data, size_t size, Pattern pattern)
+{
+  static const char text[] =
+    "Acorn RISC OS Fourth Dimension FedNet Chocks Away Stunt Racer "
+    "Star Fighter GKeyLib. ";
+  size_t i;
+
+  for (i = 0; i < size; ++i) {
+    switch (pattern) {
+      case Pattern_Random:
+        data[i] = (unsigned char)pseudo_random();
+        break;
+      case Pattern_FewSymbols:
+        data[i] = (unsigned char)("ab\0\xff"[pseudo_random() % 4]);
+        break;
+      case Pattern_Text:
+        /* Occasional typos break up long matches */
+        data[i] = pseudo_random() % 64
+                    ? (unsigned char)text[i % (sizeof(text) - 1)]
+                    : (unsigned char)pseudo_random();
+        break;
+      default:
+        data[i] = pseudo_random() % 512 ? 0 : (unsigned char)pseudo_random();
+        break;
+    }
+  }
+}
+
+static bool test_pattern(const unsigned char *data, size_t size,
+                         unsigned int history_log_2, Pattern pattern)
+{
+  size_t pos = 0, step;
+  unsigned long ncopies = 0;
+
+  while (pos < size) {
+    /* Bigger histories are only sampled, with a short limit on the match
+       length, because the reference search is slow */
+    const size_t avail =
+      history_log_2 > FULL_MAX_LOG_2 && size - pos > LARGE_AVAIL
+        ? LARGE_AVAIL
+        : size - pos;
+    const GKMatch expected =
+      gkmatch_find_scalar(data + pos, avail, history_log_2);
+    const GKMatch actual = gkmatch_find(data + pos, avail, history_log_2);
+    const GKMatch generic =
+      gkmatch_find_generic(data + pos, avail, history_log_2);
+    const GKMatch unbounded =
+      gkmatch_find_bounded(data + pos, avail, history_log_2, UINT_MAX);
+    const GKMatch bounded =
+      gkmatch_find_bounded(data + pos, avail, history_log_2, FEW_CANDIDATES);
+
+    if (expected.distance != actual.distance ||
+        expected.length != actual.length ||
+        expected.distance != generic.distance ||
+        expected.length != generic.length) {
+      fprintf(stderr,
+              "Mismatch for %s data at offset %lu with history %u: "
+              "expected %u bytes at distance %u, got %u bytes at distance %u "
+              "(%u bytes at distance %u without specialisation)\n",
+              pattern_names[pattern], (unsigned long)pos, history_log_2,
+              expected.length, expected.distance, actual.length,
+              actual.distance, generic.length, generic.distance);
+      return false;
+    }
+
+    if (expected.distance != unbounded.distance ||
+        expected.length != unbounded.length) {
+      fprintf(stderr,
+              "Mismatch for %s data at offset %lu with history %u: "
+              "expected %u bytes at distance %u, got %u bytes at distance %u "
+              "from an unbounded search\n",
+              pattern_names[pattern], (unsigned long)pos, history_log_2,
+              expected.length, expected.distance, unbounded.length,
+              unbounded.distance);
+      return false;
+    }
+
+    /* A bounded search may find a shorter match, but it must be real */
+    if (bounded.length > expected.length ||
+        (bounded.length == 0) != (expected.length == 0) ||
+        (bounded.length > 0 &&
+         (bounded.length >
+            gkmatch_max_length(bounded.distance, history_log_2) ||
+          memcmp(data + pos - bounded.distance, data + pos,
+                 bounded.length) != 0))) {
+      fprintf(stderr,
+              "Bad match for %s data at offset %lu with history %u: "
+              "%u bytes at distance %u from a bounded search\n",
+              pattern_names[pattern], (unsigned long)pos, history_log_2,
+              bounded.length, bounded.distance);
+      return false;
+    }
+
+    /* Advance like a greedy compressor so that the test follows the same
+       sequence of tokens as real output would. */
+    if (expected.length > 0 &&
+        gkmatch_copy_bits(expected.distance, history_log_2) <
+          GKMATCH_LITERAL_BITS * expected.length) {
+      step = expected.length;
+      ++ncopies;
+    } else {
+      step = 1;
+    }
+
+    if (history_log_2 > FULL_MAX_LOG_2 && step < LARGE_STEP)
+      step = LARGE_STEP;
+
+    pos += step;
+  }
+
+  DEBUGF("%lu copies from %s data with history %u\n", ncopies,
+         pattern_names[pattern], history_log_2);
+  return true;
+}
+
+int main(void)
+{
+  /* The history before the start of the input reads as zeros */
+  static unsigned char buffer[HISTORY_SIZE + DATA_SIZE];
+  unsigned char *const data = buffer + HISTORY_SIZE;
+  int rtn = EXIT_SUCCESS;
+  GKCpuPath path;
+
+  /* Test every code path that this CPU can run, not just the best */
+  for (path = GKCpu_Scalar; path < GKCpu_Count; ++path) {
+    Pattern pattern;
+
+    if (!gkcpu_supported(path))
+      continue;
+
+    if (!gkcpu_init(gkcpu_name(path)))
+      return EXIT_FAILURE;
+
+    gkmatch_select();
+    DEBUGF("Testing %s code path\n", gkcpu_name(path));
+    seed = 1;
+
+    for (pattern = Pattern_Random; pattern < Pattern_Count; ++pattern) {
+      unsigned int history_log_2;
+
+      make_data(data, DATA_SIZE, pattern);
+
+      for (history_log_2 = 0; history_log_2 <= MAX_HISTORY_LOG_2;
+           ++history_log_2) {
+        if (!test_pattern(data, DATA_SIZE, history_log_2, pattern)) {
+          fprintf(stderr, "Failed using the %s code path\n",
+                  gkcpu_name(path));
+          rtn = EXIT_FAILURE;
+        }
+      }
+    }
+  }
+
+  if (rtn == EXIT_SUCCESS)
+    puts("Match search test passed");
+
+  return rtn;
+}
@@ -0,0 +1,106 @@
+/*
+ *  Gordon Key file compression utilities
+ *  Vector match search for one instruction set
+ *  Copyright (C) 2026 Christopher Bazley
+ */
+
+/* This file has no include guard because gkmatch.c includes it once for
+   each instruction set, having defined the following:
+     VECTOR(name)  Decorates the name of a function for the instruction set
+     TARGET        Attributes of functions that use the instruction set
+     Vector        Type of a vector of BLOCK_SIZE bytes
+     BLOCK_SIZE    No. of history positions compared at once
+     LANE_SHIFT    Base 2 logarithm of the no. of mask bits per byte
+     LANE_MASK     Mask bits for one byte
+     ALL_LANES     Mask bits for every byte
+   and the functions VECTOR(load), VECTOR(splat) and VECTOR(equal_mask). */
+
+static ALWAYS_INLINE TARGET unsigned int
+VECTOR(extend_match)(const unsigned char *src, const unsigned char *data,
+                     unsigned int len, unsigned int limit)
+{
+  while (len + BLOCK_SIZE <= limit) {
+    const uint64_t diff =
+      ~VECTOR(equal_mask)(VECTOR(load)(src + len), VECTOR(load)(data + len)) &
+      ALL_LANES;
+    if (diff)
+      return len + (lowest_bit(diff) >> LANE_SHIFT);
+
+    len += BLOCK_SIZE;
+  }
+
+  while (len < limit && src[len] == data[len])
+    ++len;
+
+  return len;
+}
+
+static ALWAYS_INLINE TARGET void
+VECTOR(consider)(const unsigned char *data, size_t avail,
+                 unsigned int history_log_2, unsigned int distance,
+                 GKMatch *best)
+{
+  /* The first two bytes are already known to match */
+  const unsigned char *const src = data - distance;
+  const unsigned int limit = limit_length(distance, avail, history_log_2);
+  unsigned int len;
+
+  if (limit < best->length)
+    return;
+
+  /* Cheaply reject candidates that cannot equal the best match */
+  if (best->length > 2 && src[best->length - 1] != data[best->length - 1])
+    return;
+
+  len = VECTOR(extend_match)(src, data, 2, limit);
+  if (len >= best->length) {
+    best->distance = distance;
+    best->length = len;
+  }
+}
+
+static ALWAYS_INLINE TARGET GKMatch VECTOR(find)(const unsigned char *data,
+                                                 size_t avail,
+                                                 unsigned int history_log_2)
+{
+  const unsigned int window = 1u << history_log_2;
+  const unsigned char *const start = data - window;
+  const Vector first = VECTOR(splat)(data[0]),
+               second = VECTOR(splat)(data[1]);
+  _Optional const unsigned char *nearest = NULL;
+  GKMatch best = {0, 0};
+  unsigned int i;
+
+  assert(avail >= 2);
+  assert(window % BLOCK_SIZE == 0);
+
+  /* Compare the next two bytes against every position in the history
+     buffer, furthest first. The second load of the last block reads the
+     byte at the current position, which is valid. */
+  for (i = 0; i < window; i += BLOCK_SIZE) {
+    const unsigned char *const p = start + i;
+    const uint64_t one = VECTOR(equal_mask)(VECTOR(load)(p), first);
+    uint64_t two;
+
+    if (!one)
+      continue;
+
+    nearest = p + (highest_bit(one) >> LANE_SHIFT);
+
+    two = one & VECTOR(equal_mask)(VECTOR(load)(p + 1), second);
+    while (two) {
+      const unsigned int j = lowest_bit(two) >> LANE_SHIFT;
+      VECTOR(consider)(data, avail, history_log_2, window - i - j, &best);
+      two &= ~(LANE_MASK << (j << LANE_SHIFT));
+    }
+  }
+
+  /* Every length limit is large enough for two bytes, so only fall back to
+     a single byte match if there were no candidates. */
+  if (best.length == 0 && nearest != NULL) {
+    best.distance = (unsigned int)(data - &*nearest);
+    best.length = 1;
+  }
+
+  return best;
+}
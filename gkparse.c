@@ -0,0 +1,166 @@
+/*
+ *  Gordon Key file compression utilities
+ *  Parsing strategies for each compression level
+ *  Copyright (C) 2026 Christopher Bazley
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public Licence as published by
+ *  the Free Software Foundation; either version 2 of the Licence, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public Licence for more details.
+ *
+ *  You should have received a copy of the GNU General Public Licence
+ *  along with this program; if not, write to the Free Software
+ *  Foundation, Inc., 675 Mass Ave, Cambridge, MA 02139, USA.
+ */
+
+/* ISO library header files */
+#include <assert.h>
+#include <stddef.h>
+
+/* Local headers */
+#include "gkmatch.h"
+#include "gkparse.h"
+#include "misc.h"
+
+/* Level 1 copies the first match found; the middle levels look further and
+   defer copies that would hide a better match; level 9 searches the whole
+   history buffer and looks two positions ahead. */
+static const GKParseLevel levels[GKPARSE_MAX_LEVEL - GKPARSE_MIN_LEVEL + 1] = {
+  {1, 0},   /* 1 */
+  {4, 0},   /* 2 */
+  {16, 0},  /* 3 */
+  {16, 1},  /* 4 */
+  {64, 1},  /* 5 */
+  {256, 1}, /* 6 */
+  {256, 2}, /* 7 */
+  {0, 1},   /* 8 */
+  {0, 2},   /* 9 */
+};
+
+const GKParseLevel *gkparse_level(unsigned int level)
+{
+  assert(level >= GKPARSE_MIN_LEVEL);
+  assert(level <= GKPARSE_MAX_LEVEL);
+  return &levels[level - GKPARSE_MIN_LEVEL];
+}
+
+static long int saving(GKMatch match, unsigned int history_log_2)
+{
+  /* Get the no. of bits saved by copying instead of outputting literals */
+  if (match.length == 0)
+    return 0;
+
+  return (long int)match.length * GKMATCH_LITERAL_BITS -
+         (long int)gkmatch_copy_bits(match.distance, history_log_2);
+}
+
+size_t gkparse_tokens(const unsigned char *data, size_t avail, size_t limit,
+                      unsigned int history_log_2, unsigned int level,
+                      GKMatch *tokens, size_t max_tokens, size_t *consumed)
+{
+  const GKParseLevel *const strategy = gkparse_level(level);
+  GKMatch ahead[GKPARSE_MAX_LAZY + 1]; /* Matches found at pos onwards */
+  size_t pos = 0, nahead = 0, ntokens = 0;
+
+  assert(data != NULL || avail == 0);
+  assert(limit <= avail);
+  assert(tokens != NULL);
+  assert(consumed != NULL);
+  assert(strategy->lazy <= GKPARSE_MAX_LAZY);
+
+  while (pos < limit && ntokens < max_tokens) {
+    size_t step, best_step = 0;
+    long int best_saving;
+
+    /* Find matches at this position and any later positions to be
+       considered, reusing those found before the last literal */
+    for (step = nahead; step <= strategy->lazy && pos + step < avail;
+         ++step) {
+      ahead[step] = gkmatch_find_bounded(data + pos + step, avail - pos - step,
+                                         history_log_2,
+                                         strategy->max_candidates);
+    }
+    nahead = step;
+
+    best_saving = saving(ahead[0], history_log_2);
+    for (step = 1; step < nahead; ++step) {
+      const long int s = saving(ahead[step], history_log_2);
+      if (s > best_saving) {
+        best_saving = s;
+        best_step = step;
+      }
+    }
+
+    if (best_saving > 0 && best_step == 0) {
+      tokens[ntokens++] = ahead[0];
+      pos += ahead[0].length;
+      nahead = 0;
+    } else {
+      /* Output a literal, either because there is no worthwhile match
+         or to reach a better match at a later position */
+      tokens[ntokens].distance = 0;
+      tokens[ntokens++].length = 0;
+      ++pos;
+      for (step = 1; step < nahead; ++step)
+        ahead[step - 1] = ahead[step];
+      --nahead;
+    }
+  }
+
+  *consumed = pos;
+  return ntokens;
+}
+
+unsigned long gkparse_bits(const unsigned char *data, size_t size,
+                           unsigned int history_log_2, unsigned int level)
+{
+  GKMatch tokens[GKPARSE_BATCH_SIZE];
+  size_t pos = 0;
+  unsigned long nbits = 0;
+
+  assert(data != NULL || size == 0);
+
+  while (pos < size) {
+    size_t consumed, i;
+    const size_t ntokens =
+      gkparse_tokens(data + pos, size - pos, size - pos, history_log_2, level,
+                     tokens, GKPARSE_BATCH_SIZE, &consumed);
+
+    for (i = 0; i < ntokens; ++i) {
+      nbits += tokens[i].length > 0
+                 ? gkmatch_copy_bits(tokens[i].distance, history_log_2)
+                 : GKMATCH_LITERAL_BITS;
+    }
+    pos += consumed;
+  }
+
+  return nbits;
+}
+
+void gkparse_greedy(const unsigned char *data, size_t size,
+                    unsigned int history_log_2, GKParseStats *stats)
+{
+  size_t pos = 0;
+
+  assert(data != NULL || size == 0);
+  assert(stats != NULL);
+
+  while (pos < size) {
+    const GKMatch match = gkmatch_find(data + pos, size - pos, history_log_2);
+
+    if (saving(match, history_log_2) > 0) {
+      stats->bits += gkmatch_copy_bits(match.distance, history_log_2);
+      stats->copied += match.length;
+      pos += match.length;
+    } else {
+      stats->bits += GKMATCH_LITERAL_BITS;
+      ++stats->literals;
+      ++pos;
+    }
+  }
+}
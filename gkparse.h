@@ -0,0 +1,62 @@
+/*
+ *  Gordon Key file compression utilities
+ *  Parsing strategies for each compression level
+ *  Copyright (C) 2026 Christopher Bazley
+ */
+
+#ifndef GKPARSE_H
+#define GKPARSE_H
+
+/* ISO library header files */
+#include <stddef.h>
+
+/* Local headers */
+#include "gkmatch.h"
+
+enum {
+  GKPARSE_MIN_LEVEL = 1,
+  GKPARSE_MAX_LEVEL = 9,
+  GKPARSE_MAX_LAZY = 2, /* Maximum no. of positions to look ahead */
+  GKPARSE_BATCH_SIZE = 256 /* Suggested no. of directives to choose at once */
+};
+
+typedef struct {
+  unsigned int max_candidates; /* Passed to gkmatch_find_bounded */
+  unsigned int lazy;           /* No. of later positions at which to look
+                                  for a better match before copying */
+} GKParseLevel;
+
+typedef struct {
+  unsigned long literals; /* No. of bytes output as literals */
+  unsigned long copied;   /* No. of bytes output by copy directives */
+  unsigned long bits;     /* Total no. of bits output */
+} GKParseStats;
+
+/* Get the parsing strategy for a compression level between GKPARSE_MIN_LEVEL
+   (fastest) and GKPARSE_MAX_LEVEL (smallest output). */
+const GKParseLevel *gkparse_level(unsigned int level);
+
+/* Choose literals and copies for the data at 'data' using the strategy for
+   the given compression level, until 'limit' bytes have been consumed or
+   'max_tokens' directives have been chosen. Each directive is stored in
+   'tokens' as a match, with a length of 0 for a literal byte. Matches may be
+   up to 'avail' bytes long in total, so a copy can extend beyond the limit.
+   Returns the number of directives and outputs the number of bytes consumed.
+   The history before 'data' must be readable, as for gkmatch_find. */
+size_t gkparse_tokens(const unsigned char *data, size_t avail, size_t limit,
+                      unsigned int history_log_2, unsigned int level,
+                      GKMatch *tokens, size_t max_tokens, size_t *consumed);
+
+/* Choose literals and copies for 'size' bytes of data using the strategy for
+   the given compression level, and return the number of bits that would be
+   output. The history before 'data' must be readable, as for gkmatch_find. */
+unsigned long gkparse_bits(const unsigned char *data, size_t size,
+                           unsigned int history_log_2, unsigned int level);
+
+/* Choose literals and copies for 'size' bytes of data by always copying the
+   longest match, if worthwhile, and add the results to 'stats'. The history
+   before 'data' must be readable, as for gkmatch_find. */
+void gkparse_greedy(const unsigned char *data, size_t size,
+                    unsigned int history_log_2, GKParseStats *stats);
+
+#endif /* GKPARSE_H */
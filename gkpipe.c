@@ -0,0 +1,208 @@
+/*
+ *  Gordon Key file compression utilities
+ *  Bounded queue of data between two threads
+ *  Copyright (C) 2026 Christopher Bazley
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public Licence as published by
+ *  the Free Software Foundation; either version 2 of the Licence, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public Licence for more details.
+ *
+ *  You should have received a copy of the GNU General Public Licence
+ *  along with this program; if not, write to the Free Software
+ *  Foundation, Inc., 675 Mass Ave, Cambridge, MA 02139, USA.
+ */
+
+/* This file is only compiled if GKEY_THREADS is defined */
+
+/* ISO library header files */
+#include <assert.h>
+#include <stdbool.h>
+#include <stdlib.h>
+
+/* POSIX header files */
+#include <pthread.h>
+
+/* Local headers */
+#include "gkpipe.h"
+#include "misc.h"
+
+struct GKPipe {
+  pthread_mutex_t lock;
+  pthread_cond_t sent, released;
+  size_t nchunks;
+  size_t head;  /* Index of the next chunk to claim */
+  size_t tail;  /* Index of the next chunk to receive */
+  size_t count; /* No. of chunks claimed or sent but not yet released */
+  size_t nsent; /* No. of chunks sent but not yet received */
+  bool closed, success, cancelled;
+  char *buffer;
+  GKChunk chunks[];
+};
+
+_Optional GKPipe *gkpipe_make(size_t nchunks, size_t chunk_size)
+{
+  _Optional GKPipe *pipe;
+  size_t i;
+
+  assert(nchunks > 0);
+  assert(chunk_size > 0);
+
+  pipe = malloc(sizeof(*pipe) + nchunks * sizeof(pipe->chunks[0]));
+  if (pipe == NULL)
+    return NULL;
+
+  pipe->buffer = malloc(nchunks * chunk_size);
+  if (pipe->buffer == NULL) {
+    free(pipe);
+    return NULL;
+  }
+
+  if (pthread_mutex_init(&pipe->lock, NULL)) {
+    free(pipe->buffer);
+    free(pipe);
+    return NULL;
+  }
+
+  if (pthread_cond_init(&pipe->sent, NULL)) {
+    pthread_mutex_destroy(&pipe->lock);
+    free(pipe->buffer);
+    free(pipe);
+    return NULL;
+  }
+
+  if (pthread_cond_init(&pipe->released, NULL)) {
+    pthread_cond_destroy(&pipe->sent);
+    pthread_mutex_destroy(&pipe->lock);
+    free(pipe->buffer);
+    free(pipe);
+    return NULL;
+  }
+
+  for (i = 0; i < nchunks; ++i) {
+    pipe->chunks[i].data = pipe->buffer + i * chunk_size;
+    pipe->chunks[i].size = 0;
+    pipe->chunks[i].capacity = chunk_size;
+  }
+
+  pipe->nchunks = nchunks;
+  pipe->head = pipe->tail = pipe->count = pipe->nsent = 0;
+  pipe->closed = pipe->success = pipe->cancelled = false;
+
+  return pipe;
+}
+
+void gkpipe_destroy(_Optional GKPipe *pipe)
+{
+  if (pipe != NULL) {
+    pthread_cond_destroy(&pipe->released);
+    pthread_cond_destroy(&pipe->sent);
+    pthread_mutex_destroy(&pipe->lock);
+    free(pipe->buffer);
+    free(pipe);
+  }
+}
+
+_Optional GKChunk *gkpipe_claim(GKPipe *pipe)
+{
+  _Optional GKChunk *chunk = NULL;
+
+  assert(pipe != NULL);
+
+  pthread_mutex_lock(&pipe->lock);
+  assert(!pipe->closed);
+
+  while (pipe->count == pipe->nchunks && !pipe->cancelled)
+    pthread_cond_wait(&pipe->released, &pipe->lock);
+
+  if (!pipe->cancelled) {
+    chunk = &pipe->chunks[pipe->head];
+    chunk->size = 0;
+    ++pipe->count;
+  }
+  pthread_mutex_unlock(&pipe->lock);
+
+  return chunk;
+}
+
+void gkpipe_send(GKPipe *pipe)
+{
+  assert(pipe != NULL);
+
+  pthread_mutex_lock(&pipe->lock);
+  assert(pipe->count > pipe->nsent);
+  pipe->head = (pipe->head + 1) % pipe->nchunks;
+  ++pipe->nsent;
+  pthread_cond_signal(&pipe->sent);
+  pthread_mutex_unlock(&pipe->lock);
+}
+
+void gkpipe_close(GKPipe *pipe, bool success)
+{
+  assert(pipe != NULL);
+
+  pthread_mutex_lock(&pipe->lock);
+  pipe->closed = true;
+  pipe->success = success;
+  pthread_cond_signal(&pipe->sent);
+  pthread_mutex_unlock(&pipe->lock);
+}
+
+_Optional GKChunk *gkpipe_receive(GKPipe *pipe)
+{
+  _Optional GKChunk *chunk = NULL;
+
+  assert(pipe != NULL);
+
+  pthread_mutex_lock(&pipe->lock);
+  while (pipe->nsent == 0 && !pipe->closed)
+    pthread_cond_wait(&pipe->sent, &pipe->lock);
+
+  if (pipe->nsent > 0)
+    chunk = &pipe->chunks[pipe->tail];
+
+  pthread_mutex_unlock(&pipe->lock);
+
+  return chunk;
+}
+
+void gkpipe_release(GKPipe *pipe)
+{
+  assert(pipe != NULL);
+
+  pthread_mutex_lock(&pipe->lock);
+  assert(pipe->nsent > 0);
+  pipe->tail = (pipe->tail + 1) % pipe->nchunks;
+  --pipe->nsent;
+  --pipe->count;
+  pthread_cond_signal(&pipe->released);
+  pthread_mutex_unlock(&pipe->lock);
+}
+
+void gkpipe_cancel(GKPipe *pipe)
+{
+  assert(pipe != NULL);
+
+  pthread_mutex_lock(&pipe->lock);
+  pipe->cancelled = true;
+  pthread_cond_signal(&pipe->released);
+  pthread_mutex_unlock(&pipe->lock);
+}
+
+bool gkpipe_succeeded(GKPipe *pipe)
+{
+  bool success;
+
+  assert(pipe != NULL);
+
+  pthread_mutex_lock(&pipe->lock);
+  success = pipe->closed && pipe->success;
+  pthread_mutex_unlock(&pipe->lock);
+
+  return success;
+}
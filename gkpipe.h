@@ -0,0 +1,57 @@
+/*
+ *  Gordon Key file compression utilities
+ *  Bounded queue of data between two threads
+ *  Copyright (C) 2026 Christopher Bazley
+ */
+
+#ifndef GKPIPE_H
+#define GKPIPE_H
+
+/* This interface is only available if GKEY_THREADS is defined */
+
+/* ISO library header files */
+#include <stdbool.h>
+#include <stddef.h>
+
+/* Local headers */
+#include "misc.h"
+
+typedef struct {
+  char *data;
+  size_t size;     /* No. of bytes of valid data */
+  size_t capacity; /* No. of bytes allocated */
+} GKChunk;
+
+typedef struct GKPipe GKPipe;
+
+/* Create a pipe with a fixed number of chunks of the given capacity, to
+   be passed in order from one producer thread to one consumer thread. */
+_Optional GKPipe *gkpipe_make(size_t nchunks, size_t chunk_size);
+
+void gkpipe_destroy(_Optional GKPipe *pipe);
+
+/* Producer: wait for an empty chunk to fill. Returns NULL if the consumer
+   cancelled the transfer. */
+_Optional GKChunk *gkpipe_claim(GKPipe *pipe);
+
+/* Producer: pass the chunk last claimed to the consumer. */
+void gkpipe_send(GKPipe *pipe);
+
+/* Producer: indicate that no more chunks will be sent, and whether the
+   data was produced successfully. */
+void gkpipe_close(GKPipe *pipe, bool success);
+
+/* Consumer: wait for the next chunk sent. Returns NULL if the pipe was
+   closed and all chunks have been received. */
+_Optional GKChunk *gkpipe_receive(GKPipe *pipe);
+
+/* Consumer: return the chunk last received so that it can be reused. */
+void gkpipe_release(GKPipe *pipe);
+
+/* Consumer: stop the producer because no more chunks are wanted. */
+void gkpipe_cancel(GKPipe *pipe);
+
+/* Find out whether the producer closed the pipe successfully. */
+bool gkpipe_succeeded(GKPipe *pipe);
+
+#endif /* GKPIPE_H */
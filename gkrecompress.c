@@ -0,0 +1,301 @@
+/*
+ *  Gordon Key file compression utilities
+ *  Recompression program entry point
+ *  Copyright (C) 2026 Christopher Bazley
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public Licence as published by
+ *  the Free Software Foundation; either version 2 of the Licence, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public Licence for more details.
+ *
+ *  You should have received a copy of the GNU General Public Licence
+ *  along with this program; if not, write to the Free Software
+ *  Foundation, Inc., 675 Mass Ave, Cambridge, MA 02139, USA.
+ */
+
+/* ISO library header files */
+#include <assert.h>
+#include <errno.h>
+#include <stdbool.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#ifdef GKEY_THREADS
+/* POSIX header files */
+#include <pthread.h>
+#endif
+
+/* CBUtilLib headers */
+#include "FileRWInt.h"
+
+/* GKeyLib headers */
+#include "GKeyComp.h"
+
+/* Local headers */
+#include "gkcommon.h"
+#include "gkdecoder.h"
+#ifdef GKEY_THREADS
+#include "gkpipe.h"
+#endif
+#include "gktrace.h"
+#include "misc.h"
+#include "version.h"
+
+/* Constant numeric values */
+enum {
+  FEDNET_HEADER_SIZE = 4, /* No. of bytes in a 32 bit integer */
+  BUFFER_SIZE = 65536,    /* I/O buffer size, in bytes */
+  CHUNK_SIZE = 65536,     /* No. of bytes of uncompressed data per chunk */
+  NCHUNKS = 4             /* No. of chunks between decoder and encoder */
+};
+
+typedef struct {
+  FILE *out;
+  _Optional GKeyComp *comp;
+  GKeyParameters params;
+  long int in_total, out_total;
+  char out_buffer[BUFFER_SIZE];
+} Encoder;
+
+static bool flush_output(Encoder *enc)
+{
+  /* Empty the output buffer by writing to file */
+  const size_t nout = sizeof(enc->out_buffer) - enc->params.out_size;
+  size_t nwritten;
+
+  enc->out_total += nout;
+
+  GKTRACE_BEGIN("write");
+  nwritten = fwrite(enc->out_buffer, 1, nout, enc->out);
+  GKTRACE_END("write");
+  if (nwritten != nout) {
+    fprintf(stderr, "Failed to write %lu bytes to output: %s\n",
+            (unsigned long)nout, strerror(errno));
+    return false;
+  }
+
+  enc->params.out_buffer = enc->out_buffer;
+  enc->params.out_size = sizeof(enc->out_buffer);
+  return true;
+}
+
+static bool encode_chunk(Encoder *enc, const char *in_buffer, size_t in_size)
+{
+  /* Compress the given data, or flush any pending output if there is
+     none. */
+  const bool flush = in_size == 0;
+  GKeyStatus status;
+
+  assert(enc != NULL);
+  assert(enc->comp != NULL);
+
+  enc->params.in_buffer = in_buffer;
+  enc->params.in_size = in_size;
+  enc->in_total += in_size;
+
+  do {
+    GKTRACE_BEGIN("compress");
+    status = gkeycomp_compress(&*enc->comp, &enc->params);
+    GKTRACE_END("compress");
+
+    /* Is the output buffer full or have we finished? */
+    if (status == GKeyStatus_Finished ||
+        status == GKeyStatus_BufferOverflow || enc->params.out_size == 0) {
+      if (!flush_output(enc))
+        return false;
+
+      if (status == GKeyStatus_BufferOverflow)
+        status = GKeyStatus_OK; /* Buffer overflow has been fixed up */
+    }
+
+    if (status != GKeyStatus_OK && status != GKeyStatus_TruncatedInput &&
+        status != GKeyStatus_Finished) {
+      fprintf(stderr, "Failed to compress data\n");
+      return false;
+    }
+  } while (flush ? status != GKeyStatus_Finished : enc->params.in_size > 0);
+
+  return true;
+}
+
+#ifdef GKEY_THREADS
+typedef struct {
+  GKDecoder *dec;
+  GKPipe *pipe;
+} DecoderThreadArgs;
+
+static void *decoder_thread(void *arg)
+{
+  /* Decompress the input into chunks to be passed to the encoder */
+  const DecoderThreadArgs *const args = arg;
+  bool success = true;
+
+  GKTRACE_THREAD("decoder");
+
+  while (success && !gkdecoder_finished(args->dec)) {
+    _Optional GKChunk *const chunk = gkpipe_claim(args->pipe);
+    if (chunk == NULL) {
+      success = false; /* Cancelled by the encoder */
+    } else {
+      success = gkdecoder_read(args->dec, chunk->data, chunk->capacity,
+                               &chunk->size);
+      if (success)
+        gkpipe_send(args->pipe);
+    }
+  }
+
+  gkpipe_close(args->pipe, success);
+  return NULL;
+}
+
+static bool transcode(GKDecoder *dec, Encoder *enc)
+{
+  /* Decompress and compress the data on separate threads so that both
+     can proceed at once */
+  _Optional GKPipe *pipe = gkpipe_make(NCHUNKS, CHUNK_SIZE);
+  DecoderThreadArgs args;
+  pthread_t thread;
+  _Optional GKChunk *chunk;
+  bool success = true;
+
+  if (pipe == NULL) {
+    fprintf(stderr, "Failed to allocate memory: %s\n", strerror(errno));
+    return false;
+  }
+
+  args.dec = dec;
+  args.pipe = &*pipe;
+
+  if (pthread_create(&thread, NULL, decoder_thread, &args)) {
+    fputs("Failed to create decoder thread\n", stderr);
+    gkpipe_destroy(pipe);
+    return false;
+  }
+
+  while (success && (chunk = gkpipe_receive(&*pipe)) != NULL) {
+    if (chunk->size > 0)
+      success = encode_chunk(enc, chunk->data, chunk->size);
+
+    gkpipe_release(&*pipe);
+  }
+
+  if (success) {
+    success = gkpipe_succeeded(&*pipe);
+  } else {
+    /* Stop the decoder early */
+    gkpipe_cancel(&*pipe);
+  }
+
+  pthread_join(thread, NULL);
+  gkpipe_destroy(pipe);
+  return success;
+}
+
+#else /* GKEY_THREADS */
+
+static bool transcode(GKDecoder *dec, Encoder *enc)
+{
+  /* Alternate between decompressing and compressing each chunk */
+  static char chunk[CHUNK_SIZE];
+  bool success = true;
+
+  while (success && !gkdecoder_finished(dec)) {
+    size_t size;
+    success = gkdecoder_read(dec, chunk, sizeof(chunk), &size);
+    if (success && size > 0)
+      success = encode_chunk(enc, chunk, size);
+  }
+
+  return success;
+}
+
+#endif /* GKEY_THREADS */
+
+static bool recomp(FILE *in, FILE *out, const GKOptions *options)
+{
+  bool success = false;
+  long int expected;
+  _Optional GKDecoder *dec = NULL;
+  _Optional Encoder *enc = NULL;
+
+  assert(in != NULL);
+  assert(out != NULL);
+  assert(options != NULL);
+
+  /* Read the expected size of the decompressed data to check that the
+     file wasn't truncated or otherwise corrupted. */
+  if (!gkdecoder_read_size(in, &expected))
+    goto cleanup;
+
+  /* The uncompressed size is already known, so it can be written without
+     seeking the output stream. */
+  if (options->verbose)
+    printf("Writing uncompressed size %ld\n", expected);
+
+  if (!fwrite_int32le(expected, out)) {
+    fprintf(stderr, "Failed to write uncompressed size: %s\n",
+            strerror(errno));
+    goto cleanup;
+  }
+
+  dec = gkdecoder_make(in, options->history_log_2);
+  enc = calloc(1, sizeof(*enc));
+  if (enc != NULL) {
+    enc->out = out;
+    enc->out_total = FEDNET_HEADER_SIZE;
+    enc->params.out_buffer = enc->out_buffer;
+    enc->params.out_size = sizeof(enc->out_buffer);
+    enc->comp = gkeycomp_make(options->to_history_log_2);
+  }
+
+  if (dec == NULL || enc == NULL || enc->comp == NULL) {
+    fprintf(stderr, "Failed to allocate memory: %s\n", strerror(errno));
+    goto cleanup;
+  }
+
+  if (options->verbose)
+    printf("Recompressing from history %u to %u\n", options->history_log_2,
+           options->to_history_log_2);
+
+  if (!transcode(&*dec, &*enc) || !encode_chunk(&*enc, NULL, 0))
+    goto cleanup;
+
+  if (options->verbose) {
+    const long int in_total = FEDNET_HEADER_SIZE + gkdecoder_in_total(&*dec);
+    printf("Compression ratio %.2f%% (%ld bytes in, %ld bytes out)\n",
+           ((double)enc->out_total * 100) / in_total, in_total,
+           enc->out_total);
+  }
+
+  if (gkdecoder_out_total(&*dec) != expected) {
+    fprintf(stderr, "Decompressed %ld bytes but expected %ld\n",
+            gkdecoder_out_total(&*dec), expected);
+    goto cleanup;
+  }
+
+  success = true;
+
+cleanup:
+  gkdecoder_destroy(dec);
+  if (enc != NULL) {
+    gkeycomp_destroy(enc->comp);
+    free(enc);
+  }
+  return success;
+}
+
+int main(int argc, const char *argv[])
+{
+  static const char description[] =
+    "Gordon Key file recompression utility, " VERSION_STRING "\n"
+    "Copyright (C) 2026, Christopher Bazley";
+
+  return main_common(argc, argv, recomp, description, GKTool_Recompress,
+                     NULL);
+}
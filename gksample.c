@@ -0,0 +1,195 @@
+/*
+ *  Gordon Key file compression utilities
+ *  Estimation of compression ratio from sampled chunks
+ *  Copyright (C) 2026 Christopher Bazley
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public Licence as published by
+ *  the Free Software Foundation; either version 2 of the Licence, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public Licence for more details.
+ *
+ *  You should have received a copy of the GNU General Public Licence
+ *  along with this program; if not, write to the Free Software
+ *  Foundation, Inc., 675 Mass Ave, Cambridge, MA 02139, USA.
+ */
+
+/* ISO library header files */
+#include <assert.h>
+#include <errno.h>
+#include <stdbool.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+/* GKeyLib headers */
+#include "GKeyComp.h"
+
+/* Local headers */
+#include "gkencoder.h"
+#include "gksample.h"
+#include "gktrace.h"
+#include "misc.h"
+
+enum {
+  FEDNET_HEADER_SIZE = 4, /* No. of bytes in a 32 bit integer */
+  SAMPLE_SIZE = 4096,     /* No. of bytes in each chunk compressed */
+  SAMPLE_COUNT = GKSAMPLE_TOTAL_SIZE / SAMPLE_SIZE, /* No. of chunks
+                                                       compressed per file */
+  BUFFER_SIZE = 4096      /* I/O buffer size, in bytes */
+};
+
+static bool compress_sample(FILE *in, long int offset, long int size,
+                            unsigned int history_log_2, unsigned int level,
+                            char *in_buffer, char *out_buffer,
+                            long int *out_total)
+{
+  /* Compress 'size' bytes starting at 'offset' independently of the rest of
+     the file, in the same way as the whole file would be, and add the
+     number of bytes output to the total */
+  _Optional GKeyComp *comp = NULL;
+  _Optional GKEncoder *enc = NULL;
+  GKeyStatus status;
+  bool success = true;
+
+  if (fseek(in, offset, SEEK_SET)) {
+    fprintf(stderr, "Failed to seek sample at offset %ld\n", offset);
+    return false;
+  }
+
+  if (level > 0)
+    enc = gkencoder_make(history_log_2, level);
+  else
+    comp = gkeycomp_make(history_log_2);
+
+  if (comp == NULL && enc == NULL) {
+    fprintf(stderr, "Failed to allocate memory: %s\n", strerror(errno));
+    return false;
+  }
+
+  GKeyParameters params = {
+    .out_buffer = out_buffer,
+    .out_size = BUFFER_SIZE,
+    .in_size = 0,
+  };
+
+  do {
+    if (params.in_size == 0 && size > 0) {
+      const size_t nread = size < BUFFER_SIZE ? (size_t)size : BUFFER_SIZE;
+
+      params.in_buffer = in_buffer;
+      params.in_size = fread(in_buffer, 1, nread, in);
+      if (params.in_size != nread) {
+        fprintf(stderr, "Failed to read sample at offset %ld: %s\n", offset,
+                ferror(in) ? strerror(errno) : "unexpected end of file");
+        success = false;
+        break;
+      }
+      size -= (long int)nread;
+    }
+
+    /* Flushes any pending output once all of the input has been consumed */
+    if (enc != NULL)
+      status = gkencoder_compress(&*enc, &params);
+    else
+      status = gkeycomp_compress(&*comp, &params);
+
+    /* Only the amount of output matters, so discard it when the buffer
+       is full */
+    if (status == GKeyStatus_Finished || status == GKeyStatus_BufferOverflow ||
+        params.out_size == 0) {
+      *out_total += BUFFER_SIZE - (long int)params.out_size;
+      params.out_buffer = out_buffer;
+      params.out_size = BUFFER_SIZE;
+
+      if (status == GKeyStatus_BufferOverflow)
+        status = GKeyStatus_OK;
+    }
+  } while (status != GKeyStatus_Finished &&
+           (status == GKeyStatus_OK || status == GKeyStatus_TruncatedInput));
+
+  if (success && status != GKeyStatus_Finished) {
+    fprintf(stderr, "Failed to compress sample at offset %ld\n", offset);
+    success = false;
+  }
+
+  gkencoder_destroy(enc);
+  gkeycomp_destroy(comp);
+  return success;
+}
+
+bool gksample_ratio(FILE *in, unsigned int history_log_2, unsigned int level,
+                    bool verbose, double *ratio)
+{
+  _Optional char *in_buffer = NULL, *out_buffer = NULL;
+  long int len, in_total = 0, out_total = 0;
+  bool success = true;
+
+  assert(in != NULL);
+  assert(ratio != NULL);
+
+  if (fseek(in, 0, SEEK_END)) {
+    fprintf(stderr, "Failed to seek end of input\n");
+    return false;
+  }
+
+  len = ftell(in);
+  if (len == -1L) {
+    fprintf(stderr, "Failed to tell input file position\n");
+    return false;
+  }
+
+  if (len <= GKSAMPLE_TOTAL_SIZE) {
+    fprintf(stderr, "Input is too small to sample\n");
+    return false;
+  }
+
+  in_buffer = malloc(BUFFER_SIZE);
+  out_buffer = malloc(BUFFER_SIZE);
+  if (in_buffer == NULL || out_buffer == NULL) {
+    fprintf(stderr, "Failed to allocate memory: %s\n", strerror(errno));
+    success = false;
+  }
+
+  GKTRACE_BEGIN("sample");
+  if (success) {
+    /* Include the first and last chunks, in case of a header or trailer
+       whose compressibility differs from the body */
+    int i;
+    for (i = 0; i < SAMPLE_COUNT && success; ++i) {
+      const long int offset =
+        (long int)((double)(len - SAMPLE_SIZE) * i / (SAMPLE_COUNT - 1));
+
+      success = compress_sample(in, offset, SAMPLE_SIZE, history_log_2,
+                                level, &*in_buffer, &*out_buffer,
+                                &out_total);
+      in_total += SAMPLE_SIZE;
+    }
+  }
+  GKTRACE_END("sample");
+
+  if (success) {
+    /* Scale up the compressed size of the samples and add the header */
+    const double estimate =
+      (double)out_total * len / in_total + FEDNET_HEADER_SIZE;
+
+    *ratio = estimate * 100 / len;
+
+    if (verbose)
+      printf("Estimated compression ratio %.2f%% from %ld of %ld bytes\n",
+             *ratio, in_total, len);
+  }
+
+  if (success && fseek(in, 0, SEEK_SET)) {
+    fprintf(stderr, "Failed to seek start of input\n");
+    success = false;
+  }
+
+  free(out_buffer);
+  free(in_buffer);
+  return success;
+}
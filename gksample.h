@@ -0,0 +1,27 @@
+/*
+ *  Gordon Key file compression utilities
+ *  Estimation of compression ratio from sampled chunks
+ *  Copyright (C) 2026 Christopher Bazley
+ */
+
+#ifndef GKSAMPLE_H
+#define GKSAMPLE_H
+
+/* ISO library header files */
+#include <stdbool.h>
+#include <stdio.h>
+
+enum {
+  GKSAMPLE_TOTAL_SIZE = 32768 /* No. of bytes compressed per estimate */
+};
+
+/* Estimate the size of the compressed form of a seekable file bigger than
+   GKSAMPLE_TOTAL_SIZE, as a percentage of its size, by compressing a few
+   chunks spread evenly through it at the given level (or using GKeyLib, if
+   the level is 0). (Smaller files are cheap enough to compress in full.)
+   The file position is left at the start. Prints a message and returns
+   false on failure. */
+bool gksample_ratio(FILE *in, unsigned int history_log_2, unsigned int level,
+                    bool verbose, double *ratio);
+
+#endif /* GKSAMPLE_H */
@@ -0,0 +1,168 @@
+/*
+ *  Gordon Key file compression utilities
+ *  Trace recording (Chrome trace event format)
+ *  Copyright (C) 2026 Christopher Bazley
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public Licence as published by
+ *  the Free Software Foundation; either version 2 of the Licence, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public Licence for more details.
+ *
+ *  You should have received a copy of the GNU General Public Licence
+ *  along with this program; if not, write to the Free Software
+ *  Foundation, Inc., 675 Mass Ave, Cambridge, MA 02139, USA.
+ */
+
+/* This file is only compiled if GKEY_TRACE is defined */
+
+/* ISO library header files */
+#include <assert.h>
+#include <errno.h>
+#include <stdbool.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#ifdef GKEY_THREADS
+/* POSIX header files */
+#include <pthread.h>
+#endif
+
+/* Local headers */
+#include "filetype.h"
+#include "gktrace.h"
+#include "misc.h"
+
+enum {
+  INITIAL_CAPACITY = 4096 /* No. of events to allocate space for at first */
+};
+
+typedef struct {
+  const char *name;
+  unsigned long long timestamp; /* Microseconds since recording started */
+  unsigned int tid;             /* Thread identifier */
+  char phase;                   /* 'B' for begin, 'E' for end or 'M' */
+} TraceEvent;
+
+static _Optional TraceEvent *events;
+static size_t nevents, capacity;
+static unsigned long long start_time;
+static bool lost;
+
+#ifdef GKEY_THREADS
+static pthread_mutex_t lock = PTHREAD_MUTEX_INITIALIZER;
+static pthread_key_t tid_key;
+static unsigned int ntids = 1; /* Main thread is 1 */
+#endif
+
+static void write_trace(void)
+{
+  const char *const file_name =
+    getenv("GKEY_TRACE_FILE") ? getenv("GKEY_TRACE_FILE") : "gktrace.json";
+  _Optional FILE *f;
+  size_t i;
+
+  f = fopen(file_name, "w");
+  if (f == NULL) {
+    fprintf(stderr, "Failed to open trace file '%s': %s\n", file_name,
+            strerror(errno));
+  } else {
+    fputs("{\"traceEvents\":[", &*f);
+    for (i = 0; events != NULL && i < nevents; ++i) {
+      /* Metadata events carry the thread name as an argument */
+      const bool meta = events[i].phase == 'M';
+
+      fprintf(&*f, "%s\n{\"name\":\"%s\",\"ph\":\"%c\",\"ts\":%llu,"
+                   "\"pid\":1,\"tid\":%u",
+              i > 0 ? "," : "", meta ? "thread_name" : events[i].name,
+              events[i].phase, events[i].timestamp, events[i].tid);
+      if (meta)
+        fprintf(&*f, ",\"args\":{\"name\":\"%s\"}", events[i].name);
+      fputc('}', &*f);
+    }
+    fputs("\n],\"displayTimeUnit\":\"ms\"}\n", &*f);
+
+    if (fclose(&*f))
+      fprintf(stderr, "Failed to close trace file '%s': %s\n", file_name,
+              strerror(errno));
+  }
+
+  if (lost)
+    fputs("Some trace events were lost (out of memory)\n", stderr);
+
+  free(events);
+  events = NULL;
+}
+
+static void add_event(const char *name, char phase,
+                      unsigned long long timestamp)
+{
+  unsigned int tid = 1;
+
+#ifdef GKEY_THREADS
+  pthread_mutex_lock(&lock);
+  if (pthread_getspecific(tid_key) != NULL)
+    tid = (unsigned int)(size_t)pthread_getspecific(tid_key);
+#endif
+
+  if (nevents == capacity) {
+    const size_t new_capacity = capacity ? capacity * 2 : INITIAL_CAPACITY;
+    _Optional TraceEvent *const new_events =
+      realloc(events, new_capacity * sizeof(*events));
+
+    if (new_events == NULL) {
+      lost = true;
+    } else {
+      events = new_events;
+      capacity = new_capacity;
+    }
+  }
+
+  if (events != NULL && nevents < capacity) {
+    events[nevents].name = name;
+    events[nevents].timestamp = timestamp;
+    events[nevents].tid = tid;
+    events[nevents].phase = phase;
+    ++nevents;
+  }
+
+#ifdef GKEY_THREADS
+  pthread_mutex_unlock(&lock);
+#endif
+}
+
+void gktrace_start(void)
+{
+#ifdef GKEY_THREADS
+  if (pthread_key_create(&tid_key, NULL))
+    lost = true;
+#endif
+  start_time = clock_us();
+  atexit(write_trace);
+}
+
+void gktrace_event(const char *name, char phase)
+{
+  assert(name != NULL);
+  assert(phase == 'B' || phase == 'E');
+
+  add_event(name, phase, clock_us() - start_time);
+}
+
+void gktrace_thread(const char *name)
+{
+  assert(name != NULL);
+
+#ifdef GKEY_THREADS
+  pthread_mutex_lock(&lock);
+  pthread_setspecific(tid_key, (void *)(size_t)++ntids);
+  pthread_mutex_unlock(&lock);
+#endif
+
+  add_event(name, 'M', 0);
+}
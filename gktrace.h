@@ -0,0 +1,38 @@
+/*
+ *  Gordon Key file compression utilities
+ *  Trace recording (Chrome trace event format)
+ *  Copyright (C) 2026 Christopher Bazley
+ */
+
+#ifndef GKTRACE_H
+#define GKTRACE_H
+
+#ifdef GKEY_TRACE
+
+/* Start recording. The trace is written to the file named by the
+   environment variable GKEY_TRACE_FILE (or "gktrace.json") on exit. */
+void gktrace_start(void);
+
+/* Record the beginning or end of a span on the calling thread. The name
+   must be a string literal (or otherwise remain valid until exit). */
+void gktrace_event(const char *name, char phase);
+
+/* Name the calling thread in the trace. Threads other than the main
+   thread must call this before recording any events. */
+void gktrace_thread(const char *name);
+
+#define GKTRACE_START() gktrace_start()
+#define GKTRACE_BEGIN(name) gktrace_event(name, 'B')
+#define GKTRACE_END(name) gktrace_event(name, 'E')
+#define GKTRACE_THREAD(name) gktrace_thread(name)
+
+#else /* GKEY_TRACE */
+
+#define GKTRACE_START()
+#define GKTRACE_BEGIN(name)
+#define GKTRACE_END(name)
+#define GKTRACE_THREAD(name)
+
+#endif /* GKEY_TRACE */
+
+#endif /* GKTRACE_H */
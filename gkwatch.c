@@ -0,0 +1,571 @@
+/*
+ *  Gordon Key file compression utilities
+ *  Keep a directory of compressed files up to date
+ *  Copyright (C) 2026 Christopher Bazley
+ *
+ *  This program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public Licence as published by
+ *  the Free Software Foundation; either version 2 of the Licence, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public Licence for more details.
+ *
+ *  You should have received a copy of the GNU General Public Licence
+ *  along with this program; if not, write to the Free Software
+ *  Foundation, Inc., 675 Mass Ave, Cambridge, MA 02139, USA.
+ */
+
+/* Watch mode requires inotify (Linux) and POSIX threads */
+#if defined(__linux__) && defined(GKEY_THREADS)
+#define GKWATCH_SUPPORTED
+#define _POSIX_C_SOURCE 200809L
+#endif
+
+/* ISO library header files */
+#include <assert.h>
+#include <errno.h>
+#include <stdbool.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#ifdef GKWATCH_SUPPORTED
+/* POSIX header files */
+#include <dirent.h>
+#include <poll.h>
+#include <pthread.h>
+#include <signal.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+/* Linux header files */
+#include <sys/inotify.h>
+#include <sys/signalfd.h>
+#endif
+
+/* Local headers */
+#include "filetype.h"
+#include "gkcommon.h"
+#include "gktrace.h"
+#include "gkwatch.h"
+#include "misc.h"
+
+#ifdef GKWATCH_SUPPORTED
+
+enum {
+  DEBOUNCE_MS = 50,        /* Quiet period after a file was last written */
+  MAX_WORKERS = 8,         /* Maximum no. of files to process at once */
+  EVENT_BUFFER_SIZE = 4096 /* Size of buffer for inotify events, in bytes */
+};
+
+/* A file that was seen in the source directory. Entries are never freed
+   because the watcher only stops when the program exits. */
+typedef struct WatchEntry {
+  _Optional struct WatchEntry *next;     /* Next in the list of all files */
+  _Optional struct WatchEntry *next_job; /* Next in the queue of work */
+  unsigned long long deadline; /* Time at which to queue the file */
+  bool pending;                /* Waiting for the file to stop changing */
+  bool busy;                   /* Queued or being processed */
+  _Optional char *tmp_path;    /* Temporary output file, if any */
+  char name[];
+} WatchEntry;
+
+typedef struct {
+  const char *src_dir, *dst_dir;
+  GKProcessFn *processor;
+  const GKOptions *options;
+  bool time;
+  _Optional WatchEntry *entries; /* Only used by the main thread */
+  pthread_mutex_t lock;          /* Protects the fields below and the
+                                    temporary file of each entry */
+  pthread_cond_t work;
+  _Optional WatchEntry *queue_head, *queue_tail;
+  bool stopping;                 /* No more output may be renamed */
+} Watch;
+
+static _Optional char *make_path(const char *dir, const char *prefix,
+                                 const char *name, const char *suffix)
+{
+  const size_t len =
+    strlen(dir) + 1 + strlen(prefix) + strlen(name) + strlen(suffix) + 1;
+  _Optional char *const path = malloc(len);
+
+  if (path == NULL)
+    fprintf(stderr, "Failed to allocate memory: %s\n", strerror(errno));
+  else
+    sprintf(&*path, "%s%c%s%s%s", dir, PATH_SEPARATOR, prefix, name, suffix);
+
+  return path;
+}
+
+static bool process_one(Watch *watch, WatchEntry *entry)
+{
+  /* Write output to a hidden temporary file in the destination directory
+     and then rename it, so that the old file is replaced atomically */
+  const char *const name = entry->name;
+  const unsigned long long start_time = watch->time ? clock_us() : 0;
+  _Optional char *const src_path = make_path(watch->src_dir, "", name, "");
+  _Optional char *const dst_path = make_path(watch->dst_dir, "", name, "");
+  _Optional char *const tmp_path =
+    make_path(watch->dst_dir, ".", name, ".XXXXXX");
+  _Optional FILE *in = NULL, *out = NULL;
+  bool success = false, stopping;
+  struct stat st;
+  int fd = -1;
+
+  if (src_path == NULL || dst_path == NULL || tmp_path == NULL)
+    goto cleanup;
+
+  in = fopen(&*src_path, "rb");
+  if (in == NULL) {
+    /* The file may have been deleted or renamed since it was written */
+    if (errno == ENOENT)
+      success = true;
+    else
+      fprintf(stderr, "Failed to open input file '%s': %s\n", &*src_path,
+              strerror(errno));
+    goto cleanup;
+  }
+
+  /* Create the temporary file and record its name together, so that it
+     is removed if the watcher is stopped before it is renamed */
+  pthread_mutex_lock(&watch->lock);
+  stopping = watch->stopping;
+  if (!stopping) {
+    fd = mkstemp(&*tmp_path);
+    if (fd >= 0)
+      entry->tmp_path = tmp_path;
+  }
+  pthread_mutex_unlock(&watch->lock);
+
+  if (stopping)
+    goto cleanup;
+
+  if (fd < 0) {
+    fprintf(stderr, "Failed to create temporary output file: %s\n",
+            strerror(errno));
+    goto cleanup;
+  }
+
+  /* Give the output the same permissions as the input, instead of the
+     restrictive permissions of a temporary file */
+  if (!fstat(fileno(&*in), &st))
+    (void)fchmod(fd, st.st_mode & 0777);
+
+  out = fdopen(fd, "wb");
+  if (out == NULL) {
+    fprintf(stderr, "Failed to open temporary output file: %s\n",
+            strerror(errno));
+    close(fd);
+    pthread_mutex_lock(&watch->lock);
+    if (!watch->stopping)
+      remove(&*tmp_path);
+    entry->tmp_path = NULL;
+    pthread_mutex_unlock(&watch->lock);
+    goto cleanup;
+  }
+
+  if (watch->options->verbose)
+    printf("Processing '%s'\n", &*src_path);
+
+  GKTRACE_BEGIN("process");
+  success = watch->processor(&*in, &*out, watch->options);
+  GKTRACE_END("process");
+
+  if (fclose(&*out)) {
+    fprintf(stderr, "Failed to close output file: %s\n", strerror(errno));
+    success = false;
+  }
+
+  /* Once stopping, the temporary file has been removed already */
+  pthread_mutex_lock(&watch->lock);
+  stopping = watch->stopping;
+  if (!stopping) {
+    if (success && rename(&*tmp_path, &*dst_path)) {
+      fprintf(stderr, "Failed to rename output file to '%s': %s\n",
+              &*dst_path, strerror(errno));
+      success = false;
+    }
+
+    if (!success)
+      remove(&*tmp_path);
+  }
+  entry->tmp_path = NULL;
+  pthread_mutex_unlock(&watch->lock);
+
+  if (stopping) {
+    success = false;
+  } else if (!success) {
+    fprintf(stderr, "Failed to process '%s'\n", &*src_path);
+  } else if (watch->time) {
+    printf("Time taken for '%s': %.3f seconds\n", name,
+           (double)(clock_us() - start_time) / 1000000);
+  }
+
+  /* Output may be redirected to a log that is read while still watching */
+  if (watch->time || watch->options->verbose)
+    fflush(stdout);
+
+cleanup:
+  if (in != NULL)
+    fclose(&*in);
+
+  free(tmp_path);
+  free(dst_path);
+  free(src_path);
+  return success;
+}
+
+static void *worker_thread(void *arg)
+{
+  /* Process files from the queue of work until the program exits */
+  Watch *const watch = arg;
+
+  GKTRACE_THREAD("worker");
+
+  for (;;) {
+    _Optional WatchEntry *entry;
+
+    pthread_mutex_lock(&watch->lock);
+    while (watch->queue_head == NULL)
+      pthread_cond_wait(&watch->work, &watch->lock);
+
+    entry = watch->queue_head;
+    watch->queue_head = entry->next_job;
+    if (watch->queue_head == NULL)
+      watch->queue_tail = NULL;
+    pthread_mutex_unlock(&watch->lock);
+
+    (void)process_one(watch, &*entry);
+
+    pthread_mutex_lock(&watch->lock);
+    entry->busy = false;
+    pthread_mutex_unlock(&watch->lock);
+  }
+
+  return NULL;
+}
+
+static _Optional WatchEntry *find_entry(Watch *watch, const char *name)
+{
+  /* Find or create the entry for the named file */
+  _Optional WatchEntry *entry;
+
+  for (entry = watch->entries; entry != NULL; entry = entry->next) {
+    if (!strcmp(entry->name, name))
+      return entry;
+  }
+
+  entry = malloc(sizeof(*entry) + strlen(name) + 1);
+  if (entry == NULL) {
+    fprintf(stderr, "Failed to allocate memory: %s\n", strerror(errno));
+  } else {
+    strcpy(entry->name, name);
+    entry->pending = entry->busy = false;
+    entry->tmp_path = NULL;
+    entry->deadline = 0;
+    entry->next_job = NULL;
+    entry->next = watch->entries;
+    watch->entries = entry;
+  }
+  return entry;
+}
+
+static bool mark_changed(Watch *watch, const char *name, unsigned long long at)
+{
+  /* Process the named file after a quiet period, restarting the period
+     if the file was already waiting */
+  _Optional WatchEntry *const entry = find_entry(watch, name);
+
+  if (entry == NULL)
+    return false;
+
+  entry->pending = true;
+  entry->deadline = at;
+  return true;
+}
+
+static bool scan_directory(Watch *watch)
+{
+  /* Find files in the source directory that are newer than the output
+     (or have no output) and process them straight away */
+  const unsigned long long now = clock_us() / 1000;
+  _Optional DIR *const dir = opendir(watch->src_dir);
+  _Optional struct dirent *de;
+  bool success = true;
+
+  if (dir == NULL) {
+    fprintf(stderr, "Failed to open directory '%s': %s\n", watch->src_dir,
+            strerror(errno));
+    return false;
+  }
+
+  while (success && (de = readdir(&*dir)) != NULL) {
+    _Optional char *src_path, *dst_path;
+    struct stat src_st, dst_st;
+
+    if (de->d_name[0] == '.')
+      continue; /* Ignore hidden files, '.' and '..' */
+
+    src_path = make_path(watch->src_dir, "", de->d_name, "");
+    dst_path = make_path(watch->dst_dir, "", de->d_name, "");
+
+    if (src_path == NULL || dst_path == NULL) {
+      success = false;
+    } else if (!stat(&*src_path, &src_st) && S_ISREG(src_st.st_mode) &&
+               (stat(&*dst_path, &dst_st) ||
+                dst_st.st_mtime <= src_st.st_mtime)) {
+      success = mark_changed(watch, de->d_name, now);
+    }
+
+    free(dst_path);
+    free(src_path);
+  }
+
+  closedir(&*dir);
+  return success;
+}
+
+static bool read_events(Watch *watch, int fd)
+{
+  /* Note which files were written or moved into the source directory */
+  union {
+    struct inotify_event event; /* Aligns the buffer for events */
+    char bytes[EVENT_BUFFER_SIZE];
+  } buffer;
+  const unsigned long long deadline = clock_us() / 1000 + DEBOUNCE_MS;
+  const ssize_t len = read(fd, buffer.bytes, sizeof(buffer.bytes));
+  ssize_t pos;
+
+  if (len < 0) {
+    if (errno == EINTR || errno == EAGAIN)
+      return true;
+
+    fprintf(stderr, "Failed to read directory changes: %s\n",
+            strerror(errno));
+    return false;
+  }
+
+  for (pos = 0; pos < len;) {
+    const struct inotify_event *const event =
+      (const struct inotify_event *)(void *)(buffer.bytes + pos);
+
+    if (event->mask & IN_Q_OVERFLOW) {
+      /* Some changes were lost, so check every file */
+      if (!scan_directory(watch))
+        return false;
+    } else if (event->len > 0 && !(event->mask & IN_ISDIR) &&
+               event->name[0] != '.') {
+      if (!mark_changed(watch, event->name, deadline))
+        return false;
+    }
+
+    pos += sizeof(*event) + event->len;
+  }
+
+  return true;
+}
+
+static int dispatch(Watch *watch)
+{
+  /* Queue files that have stopped changing, and return the no. of
+     milliseconds until the next file is due, or -1 if none */
+  const unsigned long long now = clock_us() / 1000;
+  unsigned long long next = 0;
+  _Optional WatchEntry *entry;
+  bool queued = false;
+
+  pthread_mutex_lock(&watch->lock);
+  for (entry = watch->entries; entry != NULL; entry = entry->next) {
+    if (!entry->pending)
+      continue;
+
+    if (entry->deadline <= now) {
+      if (entry->busy) {
+        /* Don't process the same file twice at once, in case the older
+           output is renamed last */
+        entry->deadline = now + DEBOUNCE_MS;
+      } else {
+        entry->pending = false;
+        entry->busy = true;
+        entry->next_job = NULL;
+        if (watch->queue_tail != NULL)
+          watch->queue_tail->next_job = &*entry;
+        else
+          watch->queue_head = entry;
+        watch->queue_tail = entry;
+        queued = true;
+        continue;
+      }
+    }
+
+    if (next == 0 || entry->deadline < next)
+      next = entry->deadline;
+  }
+
+  if (queued)
+    pthread_cond_broadcast(&watch->work);
+  pthread_mutex_unlock(&watch->lock);
+
+  return next == 0 ? -1 : (int)(next - now);
+}
+
+static void stop(Watch *watch)
+{
+  /* Remove any temporary files being written, and stop workers from
+     creating or renaming any more */
+  _Optional WatchEntry *entry;
+
+  pthread_mutex_lock(&watch->lock);
+  watch->stopping = true;
+  for (entry = watch->entries; entry != NULL; entry = entry->next) {
+    if (entry->tmp_path != NULL)
+      remove(&*entry->tmp_path);
+  }
+  pthread_mutex_unlock(&watch->lock);
+}
+
+static bool same_directory(const char *a, const char *b)
+{
+  struct stat a_st, b_st;
+
+  return !stat(a, &a_st) && !stat(b, &b_st) && a_st.st_dev == b_st.st_dev &&
+         a_st.st_ino == b_st.st_ino;
+}
+
+bool gkwatch_run(const char *src_dir, const char *dst_dir,
+                 GKProcessFn *processor, const GKOptions *options, bool time)
+{
+  Watch watch = {
+    .src_dir = src_dir,
+    .dst_dir = dst_dir,
+    .processor = processor,
+    .options = options,
+    .time = time,
+  };
+  long int nworkers = sysconf(_SC_NPROCESSORS_ONLN);
+  struct pollfd pfds[2];
+  struct signalfd_siginfo info;
+  sigset_t signals, old_signals;
+  bool success = true, stopped = false;
+  int fd, sfd;
+
+  assert(src_dir != NULL);
+  assert(dst_dir != NULL);
+  assert(processor);
+  assert(options != NULL);
+
+  if (same_directory(src_dir, dst_dir)) {
+    fputs("Source and destination directories must differ\n", stderr);
+    return false;
+  }
+
+  fd = inotify_init();
+  if (fd < 0) {
+    fprintf(stderr, "Failed to watch for changes: %s\n", strerror(errno));
+    return false;
+  }
+
+  /* Start watching before scanning, so that no change is missed */
+  if (inotify_add_watch(fd, src_dir, IN_CLOSE_WRITE | IN_MOVED_TO) < 0) {
+    fprintf(stderr, "Failed to watch directory '%s': %s\n", src_dir,
+            strerror(errno));
+    close(fd);
+    return false;
+  }
+
+  /* Receive termination signals as events instead of being killed, so
+     that temporary files can be removed. Worker threads inherit the
+     signal mask, so it must be set before they are created. */
+  sigemptyset(&signals);
+  sigaddset(&signals, SIGINT);
+  sigaddset(&signals, SIGTERM);
+  pthread_sigmask(SIG_BLOCK, &signals, &old_signals);
+
+  sfd = signalfd(-1, &signals, 0);
+  if (sfd < 0) {
+    fprintf(stderr, "Failed to watch for signals: %s\n", strerror(errno));
+    pthread_sigmask(SIG_SETMASK, &old_signals, NULL);
+    close(fd);
+    return false;
+  }
+
+  pthread_mutex_init(&watch.lock, NULL);
+  pthread_cond_init(&watch.work, NULL);
+
+  if (nworkers < 1)
+    nworkers = 1;
+  else if (nworkers > MAX_WORKERS)
+    nworkers = MAX_WORKERS;
+
+  if (options->verbose)
+    printf("Watching '%s' with %ld worker thread(s)\n", src_dir, nworkers);
+
+  for (; nworkers > 0 && success; --nworkers) {
+    pthread_t thread;
+    if (pthread_create(&thread, NULL, worker_thread, &watch)) {
+      fputs("Failed to create worker thread\n", stderr);
+      success = false;
+    } else {
+      pthread_detach(thread);
+    }
+  }
+
+  if (success)
+    success = scan_directory(&watch);
+
+  pfds[0].fd = fd;
+  pfds[0].events = POLLIN;
+  pfds[1].fd = sfd;
+  pfds[1].events = POLLIN;
+
+  while (success && !stopped) {
+    const int timeout = dispatch(&watch);
+    const int n = poll(pfds, 2, timeout);
+
+    if (n < 0 && errno != EINTR) {
+      fprintf(stderr, "Failed to wait for changes: %s\n", strerror(errno));
+      success = false;
+    } else if (n > 0 && (pfds[1].revents & POLLIN)) {
+      /* Consume the signal so that it isn't delivered when unblocked */
+      stopped = read(sfd, &info, sizeof(info)) == (ssize_t)sizeof(info);
+      if (!stopped) {
+        fprintf(stderr, "Failed to read signal: %s\n", strerror(errno));
+        success = false;
+      } else if (options->verbose) {
+        printf("Stopped watching '%s'\n", src_dir);
+      }
+    } else if (n > 0) {
+      success = read_events(&watch, fd);
+    }
+  }
+
+  stop(&watch);
+
+  /* Worker threads may still be running, so their state is left for the
+     operating system to clean up when the program exits */
+  close(sfd);
+  close(fd);
+  pthread_sigmask(SIG_SETMASK, &old_signals, NULL);
+  return success && stopped;
+}
+
+#else /* GKWATCH_SUPPORTED */
+
+bool gkwatch_run(const char *src_dir, const char *dst_dir,
+                 GKProcessFn *processor, const GKOptions *options, bool time)
+{
+  NOT_USED(src_dir);
+  NOT_USED(dst_dir);
+  NOT_USED(processor);
+  NOT_USED(options);
+  NOT_USED(time);
+
+  fputs("Watch mode is not supported on this platform\n", stderr);
+  return false;
+}
+
+#endif /* GKWATCH_SUPPORTED */
@@ -0,0 +1,26 @@
+/*
+ *  Gordon Key file compression utilities
+ *  Keep a directory of compressed files up to date
+ *  Copyright (C) 2026 Christopher Bazley
+ */
+
+#ifndef GKWATCH_H
+#define GKWATCH_H
+
+/* ISO library header files */
+#include <stdbool.h>
+
+/* Local headers */
+#include "gkcommon.h"
+
+/* Process each file in the source directory that is newer than the file
+   of the same name in the destination directory, then wait for files to
+   be added or changed and process them as well. Output is written to a
+   temporary file and then renamed, so that readers of the destination
+   directory never see a partial file. Returns true if stopped by SIGINT or
+   SIGTERM, having removed any temporary files. Otherwise, only returns on
+   error, or if this platform is not supported. */
+bool gkwatch_run(const char *src_dir, const char *dst_dir,
+                 GKProcessFn *processor, const GKOptions *options, bool time);
+
+#endif /* GKWATCH_H */